@@ -0,0 +1,151 @@
+#include "blur.h"
+#include <math.h>
+#include "frame_profiler.h"
+
+Blur::Blur(Kernel kernel, uint8_t radius, float sigma, Edge edge) : kernel(kernel), r(min(max(radius, 1), Blur::MAX_RADIUS)), edge(edge) {
+  float kernel_weights[2 * Blur::MAX_RADIUS + 1];
+  float kernel_sum = 0.0f;
+  for (int k = -this->r; k <= this->r; k++) {
+    switch (kernel) {
+      case Kernel::GAUSSIAN:
+        kernel_weights[k + this->r] = sigma > 0 ? exp(-(k * k) / (2 * sigma * sigma)) : (k == 0);
+        break;
+      case Kernel::BOX:
+        kernel_weights[k + this->r] = 1.0f;
+        break;
+      case Kernel::STACK:
+        kernel_weights[k + this->r] = this->r + 1 - abs(k);
+        break;
+    }
+    kernel_sum += kernel_weights[k + this->r];
+  }
+
+  // Quantizing the weights, the center one absorbs the rounding errors so that they sum to exactly 1 << WEIGHT_SHIFT.
+  // BOX and STACK ones are whole multiples of a unit, for the running sums of pass().
+  if (kernel != Kernel::GAUSSIAN)
+    this->unit = (uint16_t)((1 << Blur::WEIGHT_SHIFT) / kernel_sum + 0.5f);
+  uint16_t others = 0;
+  for (int k = -this->r; k <= this->r; k++) {
+    if (k != 0) {
+      this->weights[k + this->r] = kernel == Kernel::GAUSSIAN ?
+        (uint16_t)(kernel_weights[k + this->r] / kernel_sum * (1 << Blur::WEIGHT_SHIFT) + 0.5f) :
+        this->unit * (uint16_t)kernel_weights[k + this->r];
+      others += this->weights[k + this->r];
+    }
+  }
+  this->weights[this->r] = (1 << Blur::WEIGHT_SHIFT) - others;
+}
+
+void Blur::pass(uint32_t *pixels, uint16_t count, uint16_t stride) {
+  const uint16_t padded = count + 2 * this->r;
+  uint8_t *red = this->line.data();
+  uint8_t *green = red + padded;
+  uint8_t *blue = green + padded;
+
+  uint32_t color;
+  int src;
+  for (int i = 0; i < padded; i++) {  // Unpacking the line, and its padding according to the edge policy
+    src = i - this->r;
+    if (src < 0 || src >= count)
+      src = (this->edge == Edge::CLAMP) ? min(max(src, 0), count - 1) : ((src % count) + count) % count;
+    color = pixels[src * stride];
+    red[i] = (color >> 16) & 0xff;
+    green[i] = (color >> 8) & 0xff;
+    blue[i] = color & 0xff;
+  }
+
+  const uint32_t rounding = 1 << (Blur::WEIGHT_SHIFT - 1);
+  if (this->kernel != Kernel::GAUSSIAN && this->r >= Blur::RUNNING_SUM_MIN_RADIUS) {
+    this->runningPass(pixels, count, stride, rounding);
+    return;
+  }
+
+  const uint16_t taps = 2 * this->r + 1;
+  uint32_t r, g, b;
+  for (int i = 0; i < count; i++) {  // Output pixel i is centered on padded pixel i + r
+    r = g = b = rounding;
+    for (int k = 0; k < taps; k++) {
+      r += this->weights[k] * red[i + k];
+      g += this->weights[k] * green[i + k];
+      b += this->weights[k] * blue[i + k];
+    }
+    pixels[i * stride] = Canvas::Color(r >> Blur::WEIGHT_SHIFT, g >> Blur::WEIGHT_SHIFT, b >> Blur::WEIGHT_SHIFT);
+  }
+}
+
+// BOX and STACK, on the line unpacked by pass() : the weighted sum of the window is unit times its sum with
+// the kernel weights, plus what the center absorbed. Moving to the next pixel, a box window loses its first
+// pixel and gains the next one. A triangular one loses its left half (center included) and gains the right
+// half that follows, and those half sums are stepped the same way.
+void Blur::runningPass(uint32_t *pixels, uint16_t count, uint16_t stride, uint32_t rounding) {
+  const uint16_t padded = count + 2 * this->r;
+  const uint8_t *red = this->line.data();
+  const uint8_t *green = red + padded;
+  const uint8_t *blue = green + padded;
+  const bool stack = this->kernel == Kernel::STACK;
+  const int32_t unit = this->unit;
+  const int32_t center = this->weights[this->r] - unit * (stack ? this->r + 1 : 1);  // Can be negative
+
+  // Window, and for STACK its halves : the r + 1 pixels up to the center, and the r after it
+  int32_t r = 0, g = 0, b = 0, left_r = 0, left_g = 0, left_b = 0, right_r = 0, right_g = 0, right_b = 0;
+  for (int k = -this->r; k <= this->r; k++) {
+    const int32_t weight = stack ? this->r + 1 - abs(k) : 1;
+    const int p = this->r + k;
+    r += weight * red[p];
+    g += weight * green[p];
+    b += weight * blue[p];
+    if (k <= 0) {
+      left_r += red[p];
+      left_g += green[p];
+      left_b += blue[p];
+    }
+    else {
+      right_r += red[p];
+      right_g += green[p];
+      right_b += blue[p];
+    }
+  }
+
+  int p = this->r;  // Center of the window, in the padded line
+  for (int i = 0; i < count; i++, p++) {
+    pixels[i * stride] = Canvas::Color((unit * r + center * red[p] + (int32_t)rounding) >> Blur::WEIGHT_SHIFT,
+                                       (unit * g + center * green[p] + (int32_t)rounding) >> Blur::WEIGHT_SHIFT,
+                                       (unit * b + center * blue[p] + (int32_t)rounding) >> Blur::WEIGHT_SHIFT);
+    if (i == count - 1)
+      break;
+    const int in = p + this->r + 1, out = p - this->r;
+    if (stack) {
+      right_r += red[in];
+      right_g += green[in];
+      right_b += blue[in];
+      r += right_r - left_r;
+      g += right_g - left_g;
+      b += right_b - left_b;
+      left_r += red[p + 1] - red[out];
+      left_g += green[p + 1] - green[out];
+      left_b += blue[p + 1] - blue[out];
+      right_r -= red[p + 1];
+      right_g -= green[p + 1];
+      right_b -= blue[p + 1];
+    }
+    else {
+      r += red[in] - red[out];
+      g += green[in] - green[out];
+      b += blue[in] - blue[out];
+    }
+  }
+}
+
+void Blur::blur(Canvas &canvas) {
+  PROFILE_SCOPE(BLUR);
+  const uint16_t w = canvas.width();
+  const uint16_t h = canvas.height();
+  const size_t line_size = 3 * (max(w, h) + 2 * this->r);
+  if (this->line.size() < line_size)  // Only allocates the first time, or if the canvas grows
+    this->line.resize(line_size);
+
+  for (int y = 0; y < h; y++)  // Horizontal pass
+    this->pass(canvas.row(y), w, 1);
+  for (int x = 0; x < w; x++)  // Vertical pass
+    this->pass(canvas.data() + x, h, w);
+}
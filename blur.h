@@ -0,0 +1,59 @@
+#ifndef BLUR_H
+#define BLUR_H
+#include <Arduino.h>
+#include <vector>
+#include "canvas.h"
+
+// Separable blur over the canvas : one horizontal and one vertical pass, each a 1D convolution done
+// in integer fixed point. The weights of a pass sum to exactly 1 << WEIGHT_SHIFT, so normalising is a
+// shift, and pixels outside of the canvas are taken from the edge (CLAMP) or the opposite side (WRAP).
+// A GAUSSIAN pass costs 2r + 1 multiply-adds per pixel and channel. BOX and STACK ones keep the sum of
+// their window running instead from RUNNING_SUM_MIN_RADIUS, so theirs doesn't grow with the radius past
+// it (below, the convolution is cheaper, and gives the same result).
+class Blur {
+  public:
+    enum class Kernel {
+      GAUSSIAN,  // exp(-k²/2σ²)
+      BOX,  // Flat, every pixel of the window weighs the same
+      STACK  // Triangular (r + 1 - |k|), what Mario Klingemann's stack blur approximates a gaussian with,
+             // and computes the same way : a running sum of the window, stepped by running sums of its halves
+    };
+    enum class Edge {CLAMP, WRAP};
+
+    static constexpr uint8_t MAX_RADIUS = 8;
+    static constexpr uint8_t WEIGHT_SHIFT = 12;
+    static constexpr uint8_t RUNNING_SUM_MIN_RADIUS = 3;
+
+    Blur(Kernel kernel, uint8_t radius, float sigma, Edge edge = Edge::CLAMP);
+    void blur(Canvas &canvas);
+    uint8_t radius() const {return this->r;}
+    uint16_t weight(int k) const {return this->weights[k + this->r];}  // Weight of the pixel at offset k, out of 1 << WEIGHT_SHIFT
+
+  private:
+    Kernel kernel;
+    uint8_t r;
+    Edge edge;
+    uint16_t weights[2 * MAX_RADIUS + 1] = {};
+    uint16_t unit = 0;  // BOX and STACK : weight of a pixel per unit of its kernel weight, the center apart
+    std::vector<uint8_t> line;  // Red, green and blue planes of the row or column being blurred, padded by r on each side
+
+    void pass(uint32_t *pixels, uint16_t count, uint16_t stride);
+    void runningPass(uint32_t *pixels, uint16_t count, uint16_t stride, uint32_t rounding);
+};
+
+class GaussianBlur: public Blur {
+  public:
+    GaussianBlur(float sigma, uint8_t radius = 1, Edge edge = Edge::CLAMP) : Blur(Kernel::GAUSSIAN, radius, sigma, edge) {};
+};
+
+class BoxBlur: public Blur {
+  public:
+    BoxBlur(uint8_t radius, Edge edge = Edge::CLAMP) : Blur(Kernel::BOX, radius, 0, edge) {};
+};
+
+class StackBlur: public Blur {
+  public:
+    StackBlur(uint8_t radius, Edge edge = Edge::CLAMP) : Blur(Kernel::STACK, radius, 0, edge) {};
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+#include <Arduino.h>
+#include <vector>
+#include <algorithm>
+
+// Flat, row-major RGB888 frame that the programs render into. Colors are packed as 0x00RRGGBB.
+// Brightness, current limiting and the LED wiring are only applied when the canvas is copied to
+// the output (see OutputStage), so effects that read back their previous frame always get
+// exactly what they wrote, whatever the brightness knob is set to.
+class Canvas {
+  private:
+    const uint16_t w, h;
+    std::vector<uint32_t> pixels;
+
+  public:
+    Canvas(uint16_t width, uint16_t height) : w(width), h(height), pixels(width * height, 0) {};
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;}
+
+    uint16_t width() const {return this->w;}
+    uint16_t height() const {return this->h;}
+    uint32_t numPixels() const {return (uint32_t)this->w * this->h;}  // Up to 65536, as MatrixLayout allows
+    uint32_t *data() {return this->pixels.data();}
+    const uint32_t *data() const {return this->pixels.data();}
+    uint32_t *row(uint16_t y) {return this->pixels.data() + y * this->w;}
+
+    void drawPixel(int16_t x, int16_t y, uint32_t color) {  // Clips like Adafruit_GFX::drawPixel, programs rely on it
+      if (x < 0 || y < 0 || x >= this->w || y >= this->h)
+        return;
+      this->pixels[y * this->w + x] = color;
+    }
+    uint32_t getPixel(int16_t x, int16_t y) const {  // Out of bounds reads are black
+      if (x < 0 || y < 0 || x >= this->w || y >= this->h)
+        return 0;
+      return this->pixels[y * this->w + x];
+    }
+    void fill(uint32_t color) {std::fill(this->pixels.begin(), this->pixels.end(), color);}
+};
+
+#endif
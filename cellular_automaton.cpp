@@ -0,0 +1,117 @@
+#include "cellular_automaton.h"
+#include <algorithm>
+
+CellularAutomaton::CellularAutomaton(int width, int height) :
+    w(width), h(height), words((width + WORD_BITS - 1) / WORD_BITS), cells(words * height, 0), scratch(words * 7, 0) {
+  const int last_columns = width - (this->words - 1) * WORD_BITS;
+  this->last_mask = last_columns == WORD_BITS ? ~(Word)0 : ((Word)1 << last_columns) - 1;
+}
+
+void CellularAutomaton::set(int x, int y, bool on) {
+  if (x < 0 || y < 0 || x >= this->w || y >= this->h)
+    return;
+  Word &word = this->row(y)[x / WORD_BITS];
+  const Word bit = (Word)1 << (x % WORD_BITS);
+  word = on ? word | bit : word & ~bit;
+}
+
+void CellularAutomaton::clear() {
+  std::fill(this->cells.begin(), this->cells.end(), 0);
+}
+
+int CellularAutomaton::count() const {
+  int count = 0;
+  for (Word word : this->cells)
+    count += sizeof(Word) == 8 ? __builtin_popcountll(word) : __builtin_popcount(word);
+  return count;
+}
+
+uint32_t CellularAutomaton::hash() const {  // FNV-1a, over the 32 bits halves of the words
+  uint32_t hash = 2166136261u;
+  for (Word word : this->cells) {
+    for (int shift = 0; shift < WORD_BITS; shift += 32) {
+      hash ^= (uint32_t)(word >> shift);
+      hash *= 16777619u;
+    }
+  }
+  return hash;
+}
+
+void CellularAutomaton::copyFrom(const CellularAutomaton &other) {
+  std::copy(other.cells.begin(), other.cells.end(), this->cells.begin());
+}
+
+void CellularAutomaton::swap(CellularAutomaton &other) {
+  std::swap(this->w, other.w);
+  std::swap(this->h, other.h);
+  std::swap(this->words, other.words);
+  std::swap(this->last_mask, other.last_mask);
+  this->cells.swap(other.cells);
+  this->scratch.swap(other.scratch);
+}
+
+void CellularAutomaton::shiftRight(Word *out, const Word *in, bool wrap) const {
+  Word carry = wrap ? (in[this->words - 1] >> ((this->w - 1) % WORD_BITS)) & 1 : 0;  // Column w - 1 goes to column 0
+  for (int k = 0; k < this->words; k++) {
+    const Word next = in[k] >> (WORD_BITS - 1);
+    out[k] = (in[k] << 1) | carry;
+    carry = next;
+  }
+  out[this->words - 1] &= this->last_mask;
+}
+
+void CellularAutomaton::shiftLeft(Word *out, const Word *in, bool wrap) const {
+  Word carry = wrap ? in[0] & 1 : 0;  // Column 0 goes to column w - 1
+  for (int k = this->words - 1; k >= 0; k--) {
+    const Word next = in[k] & 1;
+    out[k] = (in[k] >> 1) | (carry << (k == this->words - 1 ? (this->w - 1) % WORD_BITS : WORD_BITS - 1));
+    carry = next;
+  }
+}
+
+void CellularAutomaton::stepLife(CellularAutomaton &next, uint16_t birth, uint16_t survival, bool wrap) const {
+  Word *off = this->scratch.data();  // The rows outside
+  Word *shifted[6];  // Above, the row and below, shifted right then left
+  for (int i = 0; i < 6; i++)
+    shifted[i] = off + (i + 1) * this->words;
+  std::fill(off, off + this->words, 0);
+
+  for (int y = 0; y < this->h; y++) {
+    const Word *rows[3] = {
+      y > 0 ? this->row(y - 1) : wrap ? this->row(this->h - 1) : off,
+      this->row(y),
+      y < this->h - 1 ? this->row(y + 1) : wrap ? this->row(0) : off
+    };
+    for (int r = 0; r < 3; r++) {
+      this->shiftRight(shifted[2 * r], rows[r], wrap);
+      this->shiftLeft(shifted[2 * r + 1], rows[r], wrap);
+    }
+    const Word *neighbours[8] = {rows[0], rows[2], shifted[0], shifted[1], shifted[2], shifted[3], shifted[4], shifted[5]};
+    Word *out = next.row(y);
+    for (int k = 0; k < this->words; k++) {
+      // Counter of 4 bit planes, 0 to 8 : every neighbour row is added to it, for all the columns at once
+      Word count[4] = {0, 0, 0, 0};
+      for (const Word *neighbour : neighbours) {
+        Word carry = neighbour[k];
+        for (int b = 0; b < 4 && carry; b++) {
+          const Word sum = count[b] ^ carry;
+          carry &= count[b];
+          count[b] = sum;
+        }
+      }
+      Word born = 0, survive = 0;
+      for (int n = 0; n <= 8; n++) {
+        if (!((birth | survival) >> n & 1))
+          continue;
+        const Word is_n = (n & 1 ? count[0] : ~count[0]) & (n & 2 ? count[1] : ~count[1]) &
+          (n & 4 ? count[2] : ~count[2]) & (n & 8 ? count[3] : ~count[3]);
+        if (birth >> n & 1)
+          born |= is_n;
+        if (survival >> n & 1)
+          survive |= is_n;
+      }
+      out[k] = (rows[1][k] & survive) | (~rows[1][k] & born);
+    }
+    out[this->words - 1] &= this->last_mask;
+  }
+}
@@ -0,0 +1,138 @@
+#ifndef CELLULAR_AUTOMATON_H
+#define CELLULAR_AUTOMATON_H
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+// Bits of a Word of cells : the Pico's machine word, 32, and 64 on the host, where the checker is also
+// built with 32 (tools/cellular_automaton_check.cpp)
+#ifndef CELLULAR_AUTOMATON_WORD_BITS
+#if defined(ARDUINO_ARCH_RP2040)
+#define CELLULAR_AUTOMATON_WORD_BITS 32
+#else
+#define CELLULAR_AUTOMATON_WORD_BITS 64
+#endif
+#endif
+
+// Grid of cells that are either on or off, a bit each : column x of a row is bit x % WORD_BITS of its
+// word x / WORD_BITS, so a row of a panel up to 32 wide on the Pico (64 on the host) is a single machine
+// word. The rules work a word at a time, with shifts and masks : the cells of a row move, or count
+// their neighbours, all at once, and what they cost hardly depends on the width of the panel.
+// What's attached to the cells (their color...) is kept aside by the programs, the rules that move
+// cells tell them where each one went.
+class CellularAutomaton {
+  public:
+#if CELLULAR_AUTOMATON_WORD_BITS == 32
+    typedef uint32_t Word;
+#else
+    typedef uint64_t Word;
+#endif
+    static constexpr int WORD_BITS = sizeof(Word) * 8;
+
+  private:
+    int w, h;
+    int words;  // Per row
+    Word last_mask;  // Columns of the last word of a row that are on the panel, the others stay off
+    std::vector<Word> cells;
+    mutable std::vector<Word> scratch;  // Rows for the rules to work in
+
+    static int lowestBit(Word word) {return sizeof(Word) == 8 ? __builtin_ctzll(word) : __builtin_ctz(word);}
+    template <typename Move> void reportMoves(const Word *moved, int y, int dx, int dy, Move &move) const {
+      for (int k = 0; k < this->words; k++) {
+        for (Word bits = moved[k]; bits; bits &= bits - 1) {
+          const int x = k * WORD_BITS + lowestBit(bits);
+          move(x, y, x + dx, y + dy);
+        }
+      }
+    }
+
+  public:
+    CellularAutomaton(int width, int height);
+
+    int width() const {return this->w;}
+    int height() const {return this->h;}
+    int wordsPerRow() const {return this->words;}
+    Word *row(int y) {return this->cells.data() + y * this->words;}
+    const Word *row(int y) const {return this->cells.data() + y * this->words;}
+
+    bool get(int x, int y) const {  // Off outside
+      if (x < 0 || y < 0 || x >= this->w || y >= this->h)
+        return false;
+      return (this->row(y)[x / WORD_BITS] >> (x % WORD_BITS)) & 1;
+    }
+    void set(int x, int y, bool on);  // Ignored outside
+    void clear();
+    int count() const;  // Cells on
+    uint32_t hash() const;  // Of the cells on, to tell a state from another
+    void copyFrom(const CellularAutomaton &other);  // Of the same size
+    void swap(CellularAutomaton &other);
+
+    // Row operations, on wordsPerRow() words : out column x is in column x - 1, or x + 1, and the column
+    // shifted in at the edge is the one of the other edge when wrapping, off otherwise
+    void shiftRight(Word *out, const Word *in, bool wrap) const;
+    void shiftLeft(Word *out, const Word *in, bool wrap) const;
+
+    // Falling sand, from the bottom row up so that a cell falls into the room freed below it at the same
+    // step : a cell falls if the cell below is free, or else slides down to one side if both that cell
+    // and the one beside it are free. The side tried first is picked at random for every row, with
+    // rand(). The cells of walls are never free, nor is outside. Calls move(x, y, to_x, to_y) for every
+    // cell moved.
+    template <typename Move> void stepSand(const CellularAutomaton &walls, Move move) {
+      Word *free_below = this->scratch.data();
+      Word *free_beside = free_below + this->words;
+      Word *shifted = free_beside + this->words;
+      Word *shifted_beside = shifted + this->words;
+      Word *moved = shifted_beside + this->words;
+      for (int y = this->h - 2; y >= 0; y--) {
+        Word *cells = this->row(y), *below = this->row(y + 1);
+        const Word *walls_row = walls.row(y), *walls_below = walls.row(y + 1);
+        for (int k = 0; k < this->words; k++) {
+          free_below[k] = ~(below[k] | walls_below[k]);
+          moved[k] = cells[k] & free_below[k];  // Straight down
+          below[k] |= moved[k];
+          cells[k] &= ~moved[k];
+          free_below[k] &= ~moved[k];
+        }
+        this->reportMoves(moved, y, 0, 1, move);
+        free_below[this->words - 1] &= this->last_mask;
+
+        const bool right_first = rand() % 2;
+        for (int side = 0; side < 2; side++) {
+          const bool right = (side == 0) == right_first;
+          for (int k = 0; k < this->words; k++)
+            free_beside[k] = ~(cells[k] | walls_row[k]);
+          free_beside[this->words - 1] &= this->last_mask;
+          // Brings the cells beside over the ones that would move there
+          if (right) {
+            this->shiftLeft(shifted, free_below, false);
+            this->shiftLeft(shifted_beside, free_beside, false);
+          }
+          else {
+            this->shiftRight(shifted, free_below, false);
+            this->shiftRight(shifted_beside, free_beside, false);
+          }
+          for (int k = 0; k < this->words; k++) {
+            moved[k] = cells[k] & shifted[k] & shifted_beside[k];
+            cells[k] &= ~moved[k];
+          }
+          this->reportMoves(moved, y, right ? 1 : -1, 1, move);
+          if (right)
+            this->shiftRight(shifted, moved, false);
+          else
+            this->shiftLeft(shifted, moved, false);
+          for (int k = 0; k < this->words; k++) {
+            below[k] |= shifted[k];
+            free_below[k] &= ~shifted[k];
+          }
+        }
+      }
+    }
+
+    // Life-like rule, into next (of the same size) : bit n of birth is set if a cell that's off with n
+    // neighbours on turns on, bit n of survival if one that's on with n neighbours on stays on. Conway's
+    // Life is B3/S23 : birth 1 << 3, survival 1 << 2 | 1 << 3. The neighbours are counted in parallel
+    // for a whole word, by adding the 8 shifted neighbour rows bit by bit. Off outside, unless wrapping.
+    void stepLife(CellularAutomaton &next, uint16_t birth, uint16_t survival, bool wrap) const;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "config_journal.h"
+#include <string.h>
+
+uint32_t crc32(const uint8_t *data, uint32_t length, uint32_t crc) {  // Bit by bit, records are a few bytes
+  crc = ~crc;
+  for (uint32_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+ConfigJournal::ConfigJournal(FlashBackend &flash, uint32_t offset, uint8_t sectors) :
+      flash(flash), offset(offset), pages(sectors * PAGES_PER_SECTOR) {}
+
+bool ConfigJournal::readRecord(uint16_t page, Header &header, uint8_t *payload) {
+  this->flash.read(this->pageOffset(page), &header, sizeof(header));
+  if (header.magic != MAGIC || header.length > MAX_PAYLOAD)
+    return false;
+  uint32_t crc;
+  this->flash.read(this->pageOffset(page) + sizeof(header), payload, header.length);
+  this->flash.read(this->pageOffset(page) + sizeof(header) + header.length, &crc, sizeof(crc));
+  return crc == crc32(payload, header.length, crc32((const uint8_t *)&header, sizeof(header)));
+}
+
+bool ConfigJournal::isBlank(uint32_t offset, uint32_t length) {
+  uint32_t words[16];
+  for (uint32_t done = 0; done < length; done += sizeof(words)) {
+    this->flash.read(offset + done, words, sizeof(words));
+    for (uint32_t word : words)
+      if (word != 0xffffffff)
+        return false;
+  }
+  return true;
+}
+
+void ConfigJournal::scan() {
+  Header header;
+  uint8_t payload[MAX_PAYLOAD];
+  this->has_record = false;
+  for (uint16_t page = 0; page < this->pages; page++) {
+    if (!this->readRecord(page, header, payload))
+      continue;
+    // Compared as a difference, so that the sequence can wrap around
+    if (!this->has_record || (int32_t)(header.sequence - this->newest_sequence) > 0) {
+      this->has_record = true;
+      this->newest_page = page;
+      this->newest_sequence = header.sequence;
+    }
+  }
+  this->next_page = this->has_record ? (this->newest_page + 1) % this->pages : 0;
+  this->scanned = true;
+}
+
+bool ConfigJournal::load(uint8_t version, void *payload, uint8_t length) {
+  if (!this->scanned)
+    this->scan();
+  Header header;
+  uint8_t data[MAX_PAYLOAD];
+  if (!this->has_record || !this->readRecord(this->newest_page, header, data) || header.version != version || header.length != length)
+    return false;
+  memcpy(payload, data, length);
+  return true;
+}
+
+void ConfigJournal::save(uint8_t version, const void *payload, uint8_t length) {
+  if (!this->scanned)
+    this->scan();
+
+  uint8_t page_data[FlashBackend::PAGE_SIZE];
+  memset(page_data, 0xff, sizeof(page_data));
+  const Header header = {MAGIC, version, length, this->has_record ? this->newest_sequence + 1 : 0};
+  const uint32_t crc = crc32((const uint8_t *)payload, length, crc32((const uint8_t *)&header, sizeof(header)));
+  memcpy(page_data, &header, sizeof(header));
+  memcpy(page_data + sizeof(header), payload, length);
+  memcpy(page_data + sizeof(header) + length, &crc, sizeof(crc));
+
+  uint16_t page = this->next_page;
+  while (true) {
+    if (page % PAGES_PER_SECTOR == 0) {
+      // Moving into a sector, which holds the oldest records (the newest is in the previous sector) :
+      // erased unless it already is, as on a new chip.
+      if (!this->isBlank(this->pageOffset(page), FlashBackend::SECTOR_SIZE))
+        this->flash.erase(this->pageOffset(page));
+      break;
+    }
+    if (this->isBlank(this->pageOffset(page), FlashBackend::PAGE_SIZE))
+      break;
+    page = (page + 1) % this->pages;  // Left dirty by a save that lost power, skipped
+  }
+  this->flash.program(this->pageOffset(page), page_data);
+
+  this->has_record = true;
+  this->newest_page = page;
+  this->newest_sequence = header.sequence;
+  this->next_page = (page + 1) % this->pages;
+}
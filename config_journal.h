@@ -0,0 +1,63 @@
+#ifndef CONFIG_JOURNAL_H
+#define CONFIG_JOURNAL_H
+#include <stdint.h>
+
+// NOR flash as the journal sees it : erasing sets a whole sector to 0xff, programming a page can only
+// clear bits. Implemented on the RP2040's flash, and on a simulated image for the host tools.
+class FlashBackend {
+  public:
+    static constexpr uint32_t PAGE_SIZE = 256;
+    static constexpr uint32_t SECTOR_SIZE = 4096;
+
+    virtual ~FlashBackend() {}
+    virtual void read(uint32_t offset, void *data, uint32_t length) = 0;
+    virtual void erase(uint32_t offset) = 0;  // The sector at offset, which is sector aligned
+    virtual void program(uint32_t offset, const uint8_t *page) = 0;  // PAGE_SIZE bytes at offset, which is page aligned
+};
+
+// Log-structured store of one small record, in a ring of flash sectors. Every save appends a new copy
+// of the record, with a sequence number and a CRC, to the next blank page, and the newest valid copy is
+// the current one. A sector is only erased when the writing moves into it, which spreads the wear over
+// the whole ring : with 4 sectors of 16 pages, a sector is erased once every 64 saves.
+// A save cut by a power loss leaves either a page that fails its CRC, skipped from then on, or a
+// partly erased sector, erased again by the next save ; in both cases the previous copy is still there.
+// Pages are the smallest unit the RP2040's flash programs, hence one record per page.
+class ConfigJournal {
+  public:
+    static constexpr uint32_t MAX_PAYLOAD = 64;
+
+  private:
+    struct Header {
+      uint16_t magic;
+      uint8_t version;  // Layout of the payload
+      uint8_t length;  // Of the payload, followed by the CRC32 of header and payload
+      uint32_t sequence;
+    };
+    static constexpr uint16_t MAGIC = 0xc0f1;
+    static constexpr uint16_t PAGES_PER_SECTOR = FlashBackend::SECTOR_SIZE / FlashBackend::PAGE_SIZE;
+
+    FlashBackend &flash;
+    const uint32_t offset;
+    const uint16_t pages;
+    bool scanned = false;
+    bool has_record = false;
+    uint16_t newest_page;
+    uint32_t newest_sequence;
+    uint16_t next_page = 0;  // Where the next save starts looking for a blank page
+
+    uint32_t pageOffset(uint16_t page) const {return this->offset + page * FlashBackend::PAGE_SIZE;}
+    bool readRecord(uint16_t page, Header &header, uint8_t *payload);
+    bool isBlank(uint32_t offset, uint32_t length);
+    void scan();
+
+  public:
+    ConfigJournal(FlashBackend &flash, uint32_t offset, uint8_t sectors);  // At least 2 sectors, offset sector aligned
+
+    // The newest valid record, false if there is none, or if it has another version or length
+    bool load(uint8_t version, void *payload, uint8_t length);
+    void save(uint8_t version, const void *payload, uint8_t length);
+};
+
+uint32_t crc32(const uint8_t *data, uint32_t length, uint32_t crc = 0);
+
+#endif
@@ -1,25 +1,58 @@
 #include "config_save.h"
+#include <Arduino.h>
 
-unsigned int flash_target_offset = (
-  (2048 * 1024) // End of the 2MB of the Pico's flash
-  - (sizeof(AppConfig)/FLASH_PAGE_SIZE + 1)*FLASH_PAGE_SIZE  // Size of the config struct, aligned to 256bytes
-  ) & 0xFFFFF000; // no fucking clue
+void PicoFlashBackend::read(uint32_t offset, void *data, uint32_t length) {
+  memcpy(data, (const uint8_t *)(XIP_BASE + offset), length);
+}
+
+void PicoFlashBackend::erase(uint32_t offset) {
+  rp2040.idleOtherCore();
+  uint32_t ints = save_and_disable_interrupts();
+  flash_range_erase(offset, FLASH_SECTOR_SIZE);
+  restore_interrupts(ints);
+  rp2040.resumeOtherCore();
+}
+
+void PicoFlashBackend::program(uint32_t offset, const uint8_t *page) {
+  rp2040.idleOtherCore();
+  uint32_t ints = save_and_disable_interrupts();
+  flash_range_program(offset, page, FLASH_PAGE_SIZE);
+  restore_interrupts(ints);
+  rp2040.resumeOtherCore();
+}
 
-void saveConfig(AppConfig config) {
-  unsigned int dataSize = (sizeof(config)/FLASH_PAGE_SIZE + 1) * FLASH_PAGE_SIZE;
+ConfigStore::ConfigStore(FlashBackend &flash, uint32_t idle_delay) :
+      flash(flash), journal(flash, JOURNAL_OFFSET, SECTORS), idle_delay(idle_delay) {}
 
-  unsigned char* dataPtr = (unsigned char*)malloc(dataSize);
-  if (dataPtr){
-    memcpy(dataPtr, &config, sizeof(config));
-    uint32_t ints = save_and_disable_interrupts();
-    flash_range_erase(flash_target_offset, FLASH_SECTOR_SIZE);
-    flash_range_program(flash_target_offset, dataPtr, dataSize);
-    restore_interrupts(ints);
+bool ConfigStore::load(AppConfig &config) {
+  bool found = this->journal.load(VERSION, &config, sizeof(config));
+  if (!found) {
+    // Nothing in the journal yet : the config saved by the firmware before it, if it makes sense
+    AppConfig legacy;
+    this->flash.read(LEGACY_OFFSET, &legacy, sizeof(legacy));
+    found = legacy.brightness >= 0 && legacy.brightness <= 1 && legacy.selected_program >= 0 && legacy.selected_program < 256;
+    if (found)
+      config = legacy;
   }
+  this->saved = config;
+  return found;
+}
+
+void ConfigStore::set(const AppConfig &config, uint32_t now) {
+  this->pending = config;
+  this->has_pending = true;
+  this->changed_at = now;
 }
 
-AppConfig* loadConfig() {
-  const uint8_t *flash_target_contents = (const uint8_t *) (XIP_BASE + flash_target_offset);
-  AppConfig *config = (AppConfig*)flash_target_contents;
-  return config;
-}
\ No newline at end of file
+bool ConfigStore::update(uint32_t now, bool renderer_idle) {
+  if (!this->has_pending || now - this->changed_at < this->idle_delay)
+    return false;
+  if (!renderer_idle && now - this->changed_at < 2 * this->idle_delay)  // Waits for the renderer to get ahead, a while
+    return false;
+  this->has_pending = false;
+  if (memcmp(&this->pending, &this->saved, sizeof(AppConfig)) == 0)  // Turned back to where it was
+    return false;
+  this->journal.save(VERSION, &this->pending, sizeof(AppConfig));
+  this->saved = this->pending;
+  return true;
+}
@@ -4,13 +4,51 @@
 #include "hardware/sync.h"
 #include <cstdlib>
 #include <cstring>
+#include "config_journal.h"
 
 struct AppConfig {
   int selected_program;
   float brightness;
 };
 
-void saveConfig(AppConfig config);
-AppConfig* loadConfig();
+// The Pico's own flash. The code runs from it too, so erasing and programming happen with the
+// interrupts off and the other core parked, for the ~1ms of a page or the ~45ms of a sector.
+class PicoFlashBackend : public FlashBackend {
+  public:
+    void read(uint32_t offset, void *data, uint32_t length) override;
+    void erase(uint32_t offset) override;
+    void program(uint32_t offset, const uint8_t *page) override;
+};
+
+// Keeps the config in a journal in the last sectors of the flash. Changing it costs nothing, it is only
+// written once it has been left alone for idle_delay, so turning the knob through 10 programs makes a
+// single save. Saves only touch the flash when the config actually changed.
+// A save still parks the renderer's core, so it waits until that core is idle : a frame ahead, waiting
+// for the buffer on the wire (for at most another idle_delay, if it never gets ahead). The ~1ms of a page
+// then costs no frame time. The ~45ms of a sector erase, every 16 saves, also stops the core that sends
+// the frames : at 31 fps, the frame after the one on the wire goes out about 13ms late, and the one after
+// that is dropped if it takes the renderer more than the ~19ms it has left.
+class ConfigStore {
+  private:
+    static constexpr uint8_t VERSION = 1;
+    static constexpr uint8_t SECTORS = 4;
+    static constexpr uint32_t FLASH_END = 2048 * 1024;  // End of the 2MB of the Pico's flash
+    static constexpr uint32_t JOURNAL_OFFSET = FLASH_END - SECTORS * FLASH_SECTOR_SIZE;
+    static constexpr uint32_t LEGACY_OFFSET = FLASH_END - FLASH_SECTOR_SIZE;  // Where saveConfig used to write
+
+    FlashBackend &flash;
+    ConfigJournal journal;
+    const uint32_t idle_delay;
+    AppConfig saved;
+    AppConfig pending;
+    bool has_pending = false;
+    uint32_t changed_at;
+
+  public:
+    ConfigStore(FlashBackend &flash, uint32_t idle_delay);  // idle_delay in milliseconds
+    bool load(AppConfig &config);  // Leaves config alone if there is nothing valid in the flash
+    void set(const AppConfig &config, uint32_t now);
+    bool update(uint32_t now, bool renderer_idle);  // Writes the config if it is due, true if it did
+};
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,149 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+#include <stdint.h>
+#include <string.h>
+
+// Table driven replacements for the libm calls of the effect code. On the RP2040 sin, cos and atan2
+// are soft-float routines costing several microseconds each, and the programs only ever need a
+// few bits of accuracy since the result ends up as an 8-bit coordinate or color.
+// The error bounds given below are measured over the whole input range by tools/fast_math_bench.cpp.
+
+// Angle (or the phase of any cycle) where the full turn is 65536 : wrapping around is free, adding
+// two angles or multiplying an angle by an integer needs no fmod. Hues already work that way.
+typedef uint16_t angle16;
+
+static constexpr float ANGLE16_PER_RADIAN = 65536 / 6.283185307179586f;
+static constexpr uint32_t ANGLE16_PER_RADIAN_Q16 = 683565276;  // 10430.378 in Q16.16
+
+// Truncates, so 1 unit (9.6e-5 radians) of error at most. The 64 bits cast keeps the wrapping right
+// for arguments way past the 32 bits range.
+static inline angle16 angle16FromRadians(float radians) {return (angle16)(int64_t)(radians * ANGLE16_PER_RADIAN);}
+static inline angle16 angle16FromTurns(float turns) {return (angle16)(int64_t)(turns * 65536.0f);}  // Same as fmod(turns, 1) * 65536, negative turns included
+static inline float angle16ToRadians(angle16 angle) {return angle * (1 / ANGLE16_PER_RADIAN);}
+// n whole radians, exact to 1 unit for any n : the product wraps in Q16.16, which keeps the fraction
+static inline angle16 angle16WholeRadians(int32_t n) {return ((uint32_t)n * ANGLE16_PER_RADIAN_Q16) >> 16;}
+
+namespace fast_math_detail {
+  static constexpr double PI_DOUBLE = 3.14159265358979323846;
+
+  static constexpr double taylorSin(double x) {  // x in [-pi, pi], the last term is below 1e-12
+    double term = x, sum = x;
+    for (int n = 1; n < 14; n++) {
+      term *= -x * x / ((2 * n) * (2 * n + 1));
+      sum += term;
+    }
+    return sum;
+  }
+
+  static constexpr double taylorAtan(double x) {  // |x| <= tan(pi/8), the last term is below 1e-20
+    double power = x, sum = x;
+    for (int n = 1; n < 30; n++) {
+      power *= -x * x;
+      sum += power / (2 * n + 1);
+    }
+    return sum;
+  }
+
+  static constexpr double newtonSqrt(double x) {
+    double r = x > 1 ? x : 1;
+    for (int i = 0; i < 40; i++)
+      r = 0.5 * (r + x / r);
+    return r;
+  }
+
+  static constexpr int32_t roundToInt(double x) {return (int32_t)(x < 0 ? x - 0.5 : x + 0.5);}
+
+  // 256 segments over the full turn, plus the end of the last one so the interpolation never wraps
+  static constexpr struct SinTable {
+    int16_t value[257];
+  } SIN_TABLE = [] {
+    SinTable table = {};
+    for (int i = 0; i <= 256; i++)
+      table.value[i] = roundToInt(32767 * taylorSin((i <= 128 ? i : i - 256) * PI_DOUBLE / 128));
+    return table;
+  }();
+
+  // atan(i/256) for i from 0 to 256, in angle16 units (atan(1) = 8192). The argument is halved with
+  // atan(t) = 2 * atan(t / (1 + sqrt(1 + t^2))) so that the series converges quickly.
+  static constexpr struct AtanTable {
+    uint16_t value[257];
+  } ATAN_TABLE = [] {
+    AtanTable table = {};
+    for (int i = 0; i <= 256; i++) {
+      const double t = i / 256.0;
+      table.value[i] = roundToInt(2 * taylorAtan(t / (1 + newtonSqrt(1 + t * t))) * 32768 / PI_DOUBLE);
+    }
+    return table;
+  }();
+}
+
+// Q1.15 sine, -32767 to 32767. Linear interpolation in a 257 entries table (514 bytes of flash).
+// Max error 9.7e-5 (3.2 LSB) against sin(), measured over all the 65536 angles.
+static inline int16_t sin16(angle16 angle) {
+  const int16_t *table = fast_math_detail::SIN_TABLE.value + (angle >> 8);
+  return table[0] + (((table[1] - table[0]) * (int32_t)(angle & 0xff) + 128) >> 8);
+}
+static inline int16_t cos16(angle16 angle) {return sin16(angle + 16384);}
+
+// Drop-in for sin() and cos() on float radians. Max error 1.5e-4, the table's plus the truncation of
+// the angle to 16 bits, which is still below half a pixel on a 4096 pixels wide canvas.
+static inline float fastSin(float radians) {return sin16(angle16FromRadians(radians)) * (1 / 32767.0f);}
+static inline float fastCos(float radians) {return cos16(angle16FromRadians(radians)) * (1 / 32767.0f);}
+
+// Angle of the vector (x, y), like atan2(y, x) but in angle16 units, 0 for (0, 0). The octant is folded
+// away, then atan(min/max) is interpolated in a 257 entries table. One 32 bits division, which the
+// RP2040 does in hardware. Max error 1.7 units (1.6e-4 radians) for any int32 inputs.
+static inline angle16 atan2_16(int32_t y, int32_t x) {
+  uint32_t ax = x < 0 ? -(uint32_t)x : x;
+  uint32_t ay = y < 0 ? -(uint32_t)y : y;
+  uint32_t lo = ax < ay ? ax : ay;
+  uint32_t hi = ax < ay ? ay : ax;
+  if (hi == 0)
+    return 0;
+  while (hi >= 1 << 15) {  // Keeps lo << 16 within 32 bits, the ratio barely changes
+    hi >>= 1;
+    lo >>= 1;
+  }
+  const uint32_t t = (lo << 16) / hi;  // Q16 ratio, 0 to 1
+  const uint16_t *table = fast_math_detail::ATAN_TABLE.value + (t >> 8);
+  uint16_t angle = table[0] + (((table[1] - table[0]) * (t & 0xff) + 128) >> 8);
+  if (ay > ax)
+    angle = 16384 - angle;
+  if (x < 0)
+    angle = 32768 - angle;
+  return y < 0 ? (angle16)-angle : angle;
+}
+
+// floor(sqrt(value)), exact. Bit by bit, 16 iterations of shifts and compares, no multiply.
+static inline uint16_t isqrt32(uint32_t value) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value)
+    bit >>= 2;
+  while (bit) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// 1/sqrt(value) for value > 0, from the exponent halving bit trick and 2 Newton iterations, so 6 float
+// multiplies instead of a sqrt and a division. Max relative error 4.7e-6.
+static inline float fastInvSqrt(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bits = 0x5f375a86 - (bits >> 1);
+  float y;
+  memcpy(&y, &bits, sizeof(y));
+  const float half = 0.5f * value;
+  y *= 1.5f - half * y * y;
+  y *= 1.5f - half * y * y;
+  return y;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+#include <stdint.h>
+
+// Q16.16 fixed point : 16 bits of integer part and 16 bits of fraction in an int32_t, so values
+// range from -32768 to 32768 with a resolution of 1.5e-5. The RP2040's Cortex-M0+ has no FPU,
+// every float operation is a library call, so the inner loops work on these instead.
+typedef int32_t q16_16;
+
+static constexpr q16_16 Q16_ONE = 1 << 16;
+
+static inline q16_16 toQ16(float value) {return (q16_16)(value * Q16_ONE + (value < 0 ? -0.5f : 0.5f));}
+static inline float fromQ16(q16_16 value) {return value * (1.0f / Q16_ONE);}
+static inline q16_16 mulQ16(q16_16 a, q16_16 b) {return (q16_16)(((int64_t)a * b) >> 16);}
+static inline int32_t floorQ16(q16_16 value) {return value >> 16;}  // Arithmetic shift, rounds towards -infinity
+static inline q16_16 fracQ16(q16_16 value) {return value & 0xffff;}  // Always positive, 0 to 1
+
+// Q48.16, the same with an int64_t : for coordinates that outgrow Q16.16, like the animation time
+typedef int64_t q48_16;
+
+static inline q48_16 toQ48(float value) {return (q48_16)(value * Q16_ONE + (value < 0 ? -0.5f : 0.5f));}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+#include <stdint.h>
+#include "spsc_ring.h"
+
+// Hands frame buffers over from the core that renders them to the core that sends them out, without
+// locks. The pipeline only moves the indices of N buffers that the caller owns : they go around
+// through two SpscRings, free -> (render) -> ready -> (send) -> free, so a buffer is only ever in the
+// hands of one core. With 2 buffers, frame N+1 is rendered while frame N is being transmitted.
+template <uint8_t N>
+class FramePipeline {
+  static_assert(N >= 2, "A pipeline needs at least a front and a back buffer");
+
+  private:
+    static constexpr uint32_t ringSize() {  // Smallest power of 2 that holds every buffer, so pushes never fail
+      uint32_t size = 1;
+      while (size < N)
+        size *= 2;
+      return size;
+    }
+    SpscRing<uint8_t, ringSize()> free_frames;
+    SpscRing<uint8_t, ringSize()> ready_frames;
+
+  public:
+    FramePipeline() {
+      for (uint8_t i = 0; i < N; i++)
+        this->free_frames.push(i);
+    }
+
+    // Rendering core : takes a buffer to render into, false if all of them are still queued or on the wire
+    bool acquire(uint8_t &frame) {return this->free_frames.pop(frame);}
+    void publish(uint8_t frame) {this->ready_frames.push(frame);}
+
+    // Sending core : takes the oldest rendered buffer, false if there is none yet, and gives it back once sent
+    bool receive(uint8_t &frame) {return this->ready_frames.pop(frame);}
+    void release(uint8_t frame) {this->free_frames.push(frame);}
+
+    uint8_t queued() const {return this->ready_frames.size();}
+};
+
+#endif
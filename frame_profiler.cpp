@@ -0,0 +1,57 @@
+#include "frame_profiler.h"
+
+#if FRAME_PROFILER
+
+FrameProfiler frame_profiler;
+
+bool FrameProfiler::enter(ProfileStage stage) {
+  if (this->active[(uint8_t)stage])
+    return false;
+  this->active[(uint8_t)stage] = true;
+  return true;
+}
+
+void FrameProfiler::exit(ProfileStage stage, uint32_t us) {
+  this->active[(uint8_t)stage] = false;
+  if (summedPerFrame(stage)) {
+    this->frame_us[(uint8_t)stage] += us;
+    this->frame_calls[(uint8_t)stage] = true;
+  }
+  else {
+    this->add(stage, us);
+  }
+}
+
+void FrameProfiler::endFrame() {
+  for (uint8_t s = 0; s < (uint8_t)ProfileStage::COUNT; s++) {
+    if (this->frame_calls[s])  // Frames of programs that don't blur don't count as 0us of blur
+      this->add((ProfileStage)s, this->frame_us[s]);
+    this->frame_us[s] = 0;
+    this->frame_calls[s] = false;
+  }
+}
+
+void FrameProfiler::add(ProfileStage stage, uint32_t us) {
+  StageStats &stats = this->stages[(uint8_t)stage];
+  const uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+  stats.histogram[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+  stats.count++;
+  stats.total_us += us;
+  if (us > stats.max_us)
+    stats.max_us = us;
+}
+
+void FrameProfiler::reset() {
+  for (StageStats &stats : this->stages)
+    stats = {};
+}
+
+const char *FrameProfiler::name(ProfileStage stage) {
+  static const char *const NAMES[] = {
+    "buffer_wait", "iterate", "output_stage", "render", "noise", "blur", "palette", "send", "inputs", "config_save", "telemetry"
+  };
+  static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == (uint8_t)ProfileStage::COUNT, "A stage has no name");
+  return NAMES[(uint8_t)stage];
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+#include <Arduino.h>
+
+// Where the time of a frame goes, stage by stage, on the device. A stage is timed by putting
+//   PROFILE_SCOPE(ITERATE);
+// at the start of the block it covers. Every stage keeps a log2 histogram of its times, its total and
+// its longest time since the last reset, sent in the telemetry (see telemetry.h) every few seconds or on request.
+//
+// Built in only with FRAME_PROFILER set to 1 (here, or -DFRAME_PROFILER=1) : otherwise the scopes are
+// empty statements and the profiler doesn't exist at all. Built in, a scope costs two reads of the
+// microsecond timer and a few adds, about 1us. The M0+ has no cycle counter, so times are whole
+// microseconds : a stage that takes less is mostly counted as 0 or 1us, which evens out over many frames.
+#ifndef FRAME_PROFILER
+#define FRAME_PROFILER 0
+#endif
+
+enum class ProfileStage : uint8_t {
+  // Core 0, once per frame
+  BUFFER_WAIT,  // Waiting for core 1 to give a frame buffer back
+  ITERATE,  // The program
+  OUTPUT_STAGE,  // Brightness, current limiting and wire encoding
+  RENDER,  // The whole frame, from getting a buffer to publishing it
+  // Core 0, inside the programs : every call of a frame is summed into one time per frame
+  NOISE,  // Noise grids and the plasma field cache
+  BLUR,
+  PALETTE,  // Batch HSV conversions and palette rebuilds
+  // Core 1, once per frame
+  SEND,  // Starting the DMA transfer
+  INPUTS,  // Knob and button events
+  CONFIG_SAVE,  // Writing the config to the flash, when it's due
+  TELEMETRY,  // Sending the frame stats on the serial port
+  COUNT
+};
+
+#if FRAME_PROFILER
+
+class FrameProfiler {
+  public:
+    static constexpr uint8_t BUCKETS = 20;  // Bucket b counts the times from 2^(b-1) to 2^b - 1us, the last one everything from 262ms
+
+    struct StageStats {
+      uint32_t count;  // Frames
+      uint32_t max_us;
+      uint64_t total_us;
+      uint32_t histogram[BUCKETS];
+    };
+
+    // Each stage is only timed on one core. The other core may dump or reset the stats meanwhile,
+    // which at worst shows a sample that's half counted.
+    bool enter(ProfileStage stage);  // False if the stage is already being timed, by an outer scope
+    void exit(ProfileStage stage, uint32_t us);
+    void endFrame();  // On core 0, once all the stages of the frame are done
+    void reset();
+
+    const StageStats &stats(ProfileStage stage) const {return this->stages[(uint8_t)stage];}
+    static const char *name(ProfileStage stage);
+    template <typename Output> void dump(Output &out) const;  // Output has print(const char *), as Serial
+
+  private:
+    StageStats stages[(uint8_t)ProfileStage::COUNT] = {};
+    bool active[(uint8_t)ProfileStage::COUNT] = {};
+    uint32_t frame_us[(uint8_t)ProfileStage::COUNT] = {};  // Sums of the stages timed within programs
+    bool frame_calls[(uint8_t)ProfileStage::COUNT] = {};
+
+    static constexpr bool summedPerFrame(ProfileStage stage) {return stage >= ProfileStage::NOISE && stage <= ProfileStage::PALETTE;}
+    void add(ProfileStage stage, uint32_t us);
+};
+
+extern FrameProfiler frame_profiler;
+
+class ProfileScope {
+  private:
+    const ProfileStage stage;
+    const bool outer;
+    const uint32_t start;
+
+  public:
+    ProfileScope(ProfileStage stage) : stage(stage), outer(frame_profiler.enter(stage)), start(time_us_32()) {};
+    ~ProfileScope() {
+      if (this->outer)
+        frame_profiler.exit(this->stage, time_us_32() - this->start);
+    }
+};
+
+template <typename Output> void FrameProfiler::dump(Output &out) const {
+  char line[48 + 7 * BUCKETS];
+  out.print("stage         frames   mean us    max us | frames per bucket : <1us <2 <4 <8 <16 <32 <64 <128 <256 <512 <1ms <2 <4 <8 <16 <32 <66 <131 <262 >=262ms\r\n");
+  for (uint8_t s = 0; s < (uint8_t)ProfileStage::COUNT; s++) {
+    const StageStats &stats = this->stages[s];
+    int length = snprintf(line, sizeof(line), "%-12s %7lu %9lu %9lu |", name((ProfileStage)s), (unsigned long)stats.count,
+      (unsigned long)(stats.count ? stats.total_us / stats.count : 0), (unsigned long)stats.max_us);
+    for (uint8_t b = 0; b < BUCKETS; b++)
+      length += snprintf(line + length, sizeof(line) - length, " %lu", (unsigned long)stats.histogram[b]);
+    out.print(line);
+    out.print("\r\n");
+  }
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(ProfileStage::stage)
+#define PROFILE_END_FRAME() frame_profiler.endFrame()
+
+#else
+
+#define PROFILE_SCOPE(stage) do {} while (0)
+#define PROFILE_END_FRAME() do {} while (0)
+
+#endif
+
+#endif
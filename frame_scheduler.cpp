@@ -0,0 +1,29 @@
+#include "frame_scheduler.h"
+
+FrameScheduler::FrameScheduler(float framerate, uint8_t max_catch_up_frames) :
+      period_us((uint32_t)(1000000 / framerate + 0.5f)), max_lag_us(max_catch_up_frames * this->period_us) {}
+
+void FrameScheduler::start(uint64_t now_us, double time) {
+  this->start_us = now_us;
+  this->start_time = time - this->period_us * 1e-6;  // So that the first frame is at time
+  this->deadline_us = now_us + this->period_us;
+  this->stats = Stats();
+}
+
+void FrameScheduler::frameRendered(uint64_t now_us) {
+  this->stats.frames++;
+  if (now_us > this->deadline_us) {
+    const uint64_t lateness = now_us - this->deadline_us;
+    this->stats.late_frames++;
+    if (lateness > this->stats.max_lateness_us)
+      this->stats.max_lateness_us = lateness > UINT32_MAX ? UINT32_MAX : lateness;
+  }
+
+  this->deadline_us += this->period_us;  // Stays on the grid of absolute deadlines, errors don't add up
+  if (now_us > this->deadline_us + this->max_lag_us) {
+    // Too far behind to catch up, skips to the first deadline still ahead
+    const uint64_t skipped = (now_us - this->deadline_us) / this->period_us + 1;
+    this->deadline_us += skipped * this->period_us;
+    this->stats.dropped_frames += skipped;
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+#include <stdint.h>
+
+// Paces the frames against absolute deadlines on a microsecond clock, one every period, and derives the
+// animation time from the deadline of the frame : the time a frame shows is the time it is displayed,
+// however long it took to render, so a program that overruns drops frames instead of slowing down.
+// A frame that is late by less than max_catch_up_frames periods is caught up, the next ones being
+// rendered back to back until the schedule is met again. Later than that, the missed deadlines are
+// skipped. The clock is passed in, so that it works the same on the Pico and in host tools.
+class FrameScheduler {
+  public:
+    struct Stats {
+      uint32_t frames = 0;
+      uint32_t late_frames = 0;  // Rendered after their deadline
+      uint32_t dropped_frames = 0;  // Deadlines skipped to get back on schedule
+      uint32_t max_lateness_us = 0;
+    };
+
+  private:
+    const uint32_t period_us;
+    const uint32_t max_lag_us;
+    uint64_t start_us = 0;
+    uint64_t deadline_us = 0;  // Deadline of the frame being rendered
+    double start_time = 0;
+    Stats stats;
+
+  public:
+    FrameScheduler(float framerate, uint8_t max_catch_up_frames = 1);
+    void start(uint64_t now_us, double time = 0);  // The first frame is due a period from now, at time
+    void frameRendered(uint64_t now_us);  // Moves on to the next frame
+
+    uint64_t deadline() const {return this->deadline_us;}  // When the frame being rendered must be shown
+    double time() const {return this->start_time + (this->deadline_us - this->start_us) * 1e-6;}  // Its animation time, in seconds
+    uint32_t period() const {return this->period_us;}
+    const Stats &getStats() const {return this->stats;}
+};
+
+#endif
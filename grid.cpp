@@ -0,0 +1,17 @@
+#include "grid.h"
+#if GRID_BOUNDS_CHECK
+#include <Arduino.h>
+
+static void printOutOfBounds(int x, int y, int width, int height) {
+  Serial.print("Grid access out of bounds : (");
+  Serial.print(x);
+  Serial.print(", ");
+  Serial.print(y);
+  Serial.print(") in ");
+  Serial.print(width);
+  Serial.print("x");
+  Serial.println(height);
+}
+
+GridBoundsHandler grid_bounds_handler = printOutOfBounds;
+#endif
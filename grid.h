@@ -0,0 +1,86 @@
+#ifndef GRID_H
+#define GRID_H
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+// Flat, row-major 2D map of the simulation programs (heat, sand, drops...), indexed (x, y) as the Canvas :
+// one allocation when the program is built, none afterwards, and a row is contiguous.
+//
+// With GRID_BOUNDS_CHECK, every access through (x, y) is checked : one out of the grid is reported to
+// grid_bounds_handler and lands on the nearest cell, instead of on a neighbouring row or past the buffer,
+// where AddressSanitizer wouldn't always see it. The host tools that check for memory errors are built
+// with it, the firmware isn't.
+#ifndef GRID_BOUNDS_CHECK
+#define GRID_BOUNDS_CHECK 0
+#endif
+
+#if GRID_BOUNDS_CHECK
+typedef void (*GridBoundsHandler)(int x, int y, int width, int height);
+extern GridBoundsHandler grid_bounds_handler;  // Prints the access on Serial, unless replaced
+#endif
+
+// A row or a column of a Grid : size cells, stride apart
+template <typename T> class GridSpan {
+  private:
+    T *first;
+    int n;
+    int stride;
+
+  public:
+    GridSpan(T *first, int size, int stride) : first(first), n(size), stride(stride) {};
+
+    int size() const {return this->n;}
+    T &operator[](int i) const {return this->first[i * this->stride];}
+    T *data() const {return this->first;}  // Contiguous for a row only
+};
+
+template <typename T> class Grid {
+  private:
+    int w, h;
+    std::vector<T> cells;
+
+    int index(int x, int y) const {
+#if GRID_BOUNDS_CHECK
+      if (!this->contains(x, y)) {
+        grid_bounds_handler(x, y, this->w, this->h);
+        x = std::min(std::max(x, 0), this->w - 1);
+        y = std::min(std::max(y, 0), this->h - 1);
+      }
+#endif
+      return y * this->w + x;
+    }
+
+  public:
+    Grid(int width, int height, T value = T()) : w(width), h(height), cells(width * height, value) {};
+
+    int width() const {return this->w;}
+    int height() const {return this->h;}
+    bool contains(int x, int y) const {return x >= 0 && y >= 0 && x < this->w && y < this->h;}
+
+    T &operator()(int x, int y) {return this->cells[this->index(x, y)];}
+    const T &operator()(int x, int y) const {return this->cells[this->index(x, y)];}
+    T get(int x, int y, T outside) const {return this->contains(x, y) ? this->cells[y * this->w + x] : outside;}  // For neighbours that may be out
+
+    T *data() {return this->cells.data();}
+    const T *data() const {return this->cells.data();}
+    T *row(int y) {return this->cells.data() + this->index(0, y);}
+    const T *row(int y) const {return this->cells.data() + this->index(0, y);}
+    GridSpan<T> rowSpan(int y) {return GridSpan<T>(this->row(y), this->w, 1);}
+    GridSpan<T> column(int x) {return GridSpan<T>(this->cells.data() + this->index(x, 0), this->h, this->w);}
+
+    void fill(T value) {std::fill(this->cells.begin(), this->cells.end(), value);}
+    void fillRow(int y, T value) {std::fill_n(this->row(y), this->w, value);}
+    // Moves the rows up by one, the top one is lost and the bottom one keeps its values
+    void scrollUp() {std::copy(this->cells.begin() + this->w, this->cells.end(), this->cells.begin());}
+    void copyFrom(const Grid &other) {std::copy(other.cells.begin(), other.cells.end(), this->cells.begin());}  // Of the same size
+    // Double buffering : the buffers are exchanged, nothing is copied
+    void swap(Grid &other) {
+      std::swap(this->w, other.w);
+      std::swap(this->h, other.h);
+      this->cells.swap(other.cells);
+    }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+// Stand-in for the Arduino core (arduino-pico) when the sketch and its programs are built for the host,
+// see CMakeLists.txt. Only what the sources use is there. The clock is the host runtime's (host_runtime.h),
+// the pins read as pulled up and nothing ever triggers their interrupts.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <cmath>
+#include "pico/time.h"
+
+typedef unsigned int uint;  // From the Pico SDK
+typedef uint8_t byte;
+typedef uint16_t word;
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+
+// Same templates as ArduinoCore-API, which mix argument types the way the sketch does (max(0.01, min(1.0, x)))
+template <class T, class L> auto min(const T &a, const L &b) -> decltype((b < a) ? b : a) {return (b < a) ? b : a;}
+template <class T, class L> auto max(const T &a, const L &b) -> decltype((b < a) ? b : a) {return (a < b) ? b : a;}
+using std::abs;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 3
+#define FALLING 4
+#define RISING 5
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+uint32_t time_us_32();
+static inline void tight_loop_contents() {}
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+int analogRead(uint8_t pin);
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+
+// Serial prints the way Arduino's Print does (2 decimals for floats), to the file given to
+// hostSetSerialOutput(), or nowhere
+class HostSerial {
+  private:
+    void format(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  public:
+    void begin(unsigned long baud) {}
+    int available() {return 0;}
+    int read() {return -1;}
+    size_t write(const uint8_t *data, size_t length);
+
+    void print(const char *text) {this->format("%s", text);}
+    void print(char c) {this->format("%c", c);}
+    void print(int n) {this->format("%d", n);}
+    void print(unsigned int n) {this->format("%u", n);}
+    void print(long n) {this->format("%ld", n);}
+    void print(unsigned long n) {this->format("%lu", n);}
+    void print(double n, int digits = 2) {this->format("%.*f", digits, n);}
+    template <typename T> void println(T value) {this->print(value); this->println();}
+    void println() {this->format("\r\n");}
+};
+extern HostSerial Serial;
+
+// The other core is never parked on the host, flash writes are instantaneous
+class HostRP2040 {
+  public:
+    void idleOtherCore() {}
+    void resumeOtherCore() {}
+    int getUsedHeap();  // Bytes allocated with new
+};
+extern HostRP2040 rp2040;
+
+#endif
@@ -0,0 +1,196 @@
+// Runs the sketch on the host, against the stand-ins of host/, and writes the frames it renders.
+//
+// By default only core 0 runs, on the simulated clock : this runner takes the place of core 1, takes
+// every frame out of the pipeline as soon as it is rendered and moves the clock to its deadline. So the
+// frames are exactly those the panel would show, at the framerate of the sketch, but rendered as fast as
+// the host goes, and the same from one run to the next. With --threads both cores run, each on its own
+// thread, through setup1() and loop1() and the simulated strip of HostLedOutput, on a real-time clock.
+// Built with -DFRAME_PROFILER=ON, the --threads runs end with the frame profile on stderr, unless the
+// serial port goes there : the telemetry has it then.
+//
+//   firmware_host --program 13 --frames 310 --scale 16 > lava_lamp.y4m
+//   firmware_host --program 15 --format ansi
+#include <ctype.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include "host_runtime.h"
+#include "host_led_output.h"
+#include "frame_writer.h"
+#include "../main.ino"
+
+FrameWriter frame_writer(WIDTH, HEIGHT, PanelLayout::index.led, FRAMERATE);
+HostLedOutput host_led_output(frame_writer);
+LedOutput &led_output = host_led_output;
+
+struct Options {
+  uint32_t frames = 10 * FRAMERATE;
+  int program = -1;  // Those of the config in the flash if negative, as on the Pico
+  float brightness = 1;
+  FrameFormat format = FrameFormat::Y4M;
+  uint8_t scale = 1;
+  bool canvas = false;
+  double speed = 0;  // Simulated seconds per real second, 0 for as fast as possible
+  bool threads = false;
+  bool serial = false;
+  const char *output = nullptr;
+};
+
+static void usage(const char *name) {
+  fprintf(stderr,
+    "Usage : %s [options]\n"
+    "  --frames N        Frames to write (%d)\n"
+    "  --program N       Program to run, by number or name (that of the saved config, the first one without)\n"
+    "  --brightness B    Brightness knob, 0 to 1 (1)\n"
+    "  --format F        wire, rgb, ppm, y4m or ansi (ansi on a terminal, y4m otherwise)\n"
+    "  --scale N         Scales the ppm, y4m and rgb frames up N times (1)\n"
+    "  --canvas          Writes the frames as the program drew them, before brightness and current limiting\n"
+    "  --speed X         Runs X times as fast as the panel, 0 for as fast as possible (0, 1 for ansi)\n"
+    "  --threads         Runs both cores on threads, on a real-time clock, instead of core 0 only\n"
+    "  --serial          Writes what the sketch sends on the serial port, its telemetry, to stderr\n"
+    "  --output FILE     Writes the frames to FILE instead of stdout\n",
+    name, 10 * FRAMERATE);
+  fprintf(stderr, "Programs :\n");
+  for (uint8_t i = 0; i < ProgramRegistry::size(); i++)
+    fprintf(stderr, "  %2u %s%s\n", i, ProgramRegistry::get(i).name, ProgramRegistry::get(i).on_knob ? "" : " (not on the knob)");
+}
+
+static bool parseOptions(int argc, char **argv, Options &options) {
+  bool has_format = false, has_speed = false;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--canvas") == 0) {
+      options.canvas = true;
+      continue;
+    }
+    if (strcmp(arg, "--threads") == 0) {
+      options.threads = true;
+      continue;
+    }
+    if (strcmp(arg, "--serial") == 0) {
+      options.serial = true;
+      continue;
+    }
+    if (i + 1 == argc)  // The other options all take a value
+      return false;
+    const char *value = argv[++i];
+    if (strcmp(arg, "--frames") == 0) {
+      options.frames = atoi(value);
+    }
+    else if (strcmp(arg, "--program") == 0) {
+      options.program = isdigit(value[0]) ? atoi(value) : ProgramRegistry::find(value);
+      if (options.program < 0)
+        return false;
+    }
+    else if (strcmp(arg, "--brightness") == 0) {
+      options.brightness = atof(value);
+    }
+    else if (strcmp(arg, "--format") == 0) {
+      if (!FrameWriter::parseFormat(value, options.format))
+        return false;
+      has_format = true;
+    }
+    else if (strcmp(arg, "--scale") == 0) {
+      options.scale = max(1, min(255, atoi(value)));
+    }
+    else if (strcmp(arg, "--speed") == 0) {
+      options.speed = atof(value);
+      has_speed = true;
+    }
+    else if (strcmp(arg, "--output") == 0) {
+      options.output = value;
+    }
+    else {
+      return false;
+    }
+  }
+  if (!has_format && isatty(options.output ? -1 : STDOUT_FILENO))
+    options.format = FrameFormat::ANSI;
+  if (!has_speed && options.format == FrameFormat::ANSI)
+    options.speed = 1;  // A preview is meant to be watched
+  if (options.threads && options.speed <= 0)
+    options.speed = 1;
+  return options.program < ProgramRegistry::size() && options.brightness >= 0 && options.brightness <= 1
+    && !(options.threads && options.canvas);  // The canvas belongs to core 0 while the frames are written by core 1
+}
+
+static void applyOptions(const Options &options) {  // Over the config setup() loaded
+  if (options.program >= 0)
+    selected_program = options.program;
+  brightness = options.brightness;
+}
+
+// Core 0 only, the runner sends the frames
+static void runSimulated(const Options &options) {
+  const auto real_start = std::chrono::steady_clock::now();
+  output_ready = true;
+  setup();
+  applyOptions(options);
+  while (frame_writer.framesWritten() < options.frames) {
+    loop();
+    uint8_t f;
+    frame_pipeline.receive(f);
+    hostSetClock(frames[f].deadline);  // Shown at its deadline, and the next one is rendered from there
+    if (options.speed > 0)
+      std::this_thread::sleep_until(real_start + std::chrono::microseconds((uint64_t)(frames[f].deadline / options.speed)));
+    if (options.canvas)
+      frame_writer.writeCanvas(canvas);
+    else
+      frame_writer.writeWire(frames[f].wire);
+    frame_pipeline.release(f);
+  }
+}
+
+#if FRAME_PROFILER
+struct StderrOutput {
+  void print(const char *text) {fputs(text, stderr);}
+};
+#endif
+
+// Both cores, as on the Pico
+static void runThreads(const Options &options) {
+  hostRunInRealTime(options.speed);
+  std::atomic<bool> running{true};
+  std::thread core1([&running] {
+    hostSetCore(1);
+    setup1();
+    while (running)
+      loop1();
+  });
+  setup();
+  applyOptions(options);
+  while (frame_writer.framesWritten() < options.frames)
+    loop();
+  running = false;
+  core1.join();
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage(argv[0]);
+    return 1;
+  }
+  FILE *out = options.output ? fopen(options.output, "wb") : stdout;
+  if (!out) {
+    perror(options.output);
+    return 1;
+  }
+  if (options.serial)
+    hostSetSerialOutput(stderr);
+  frame_writer.begin(out, options.format, options.scale);
+  if (options.threads)
+    runThreads(options);
+  else
+    runSimulated(options);
+#if FRAME_PROFILER
+  if (options.threads && !options.serial) {  // On the simulated clock no time passes while a frame is rendered, and the serial port has it already
+    StderrOutput err;
+    frame_profiler.dump(err);
+  }
+#endif
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
@@ -0,0 +1,118 @@
+#include "frame_writer.h"
+
+void FrameWriter::begin(FILE *out, FrameFormat format, uint8_t scale) {
+  this->out = out;
+  this->format = format;
+  this->scale = format == FrameFormat::PPM || format == FrameFormat::Y4M || format == FrameFormat::RGB ? max(1, scale) : 1;
+  this->scaled.resize(this->width * this->scale * this->height * this->scale * 3);
+  if (format == FrameFormat::Y4M) {
+    const int rate = (int)(this->framerate * 1000 + 0.5f);
+    fprintf(out, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C444\n", this->width * this->scale, this->height * this->scale, rate);
+  }
+  else if (format == FrameFormat::ANSI) {
+    fprintf(out, "\x1b[2J");  // Clears the terminal once, the frames are then drawn over each other
+  }
+}
+
+void FrameWriter::writeWire(const uint8_t *wire) {
+  if (this->format == FrameFormat::WIRE) {
+    fwrite(wire, 3, this->width * this->height, this->out);
+  }
+  else {
+    for (uint32_t i = 0; i < (uint32_t)this->width * this->height; i++) {
+      const uint8_t *led = wire + this->led_index[i] * 3;
+      this->rgb[i * 3] = led[1];
+      this->rgb[i * 3 + 1] = led[0];
+      this->rgb[i * 3 + 2] = led[2];
+    }
+    this->writeImage();
+  }
+  fflush(this->out);  // A reader at the other end of a pipe gets the frame now, not when the buffer fills
+  this->frames++;
+}
+
+void FrameWriter::writeCanvas(const Canvas &canvas) {
+  const uint32_t *pixels = canvas.data();
+  if (this->format == FrameFormat::WIRE) {
+    std::vector<uint8_t> wire(this->width * this->height * 3);
+    for (uint32_t i = 0; i < (uint32_t)this->width * this->height; i++) {
+      uint8_t *led = &wire[this->led_index[i] * 3];
+      led[0] = pixels[i] >> 8;
+      led[1] = pixels[i] >> 16;
+      led[2] = pixels[i];
+    }
+    fwrite(wire.data(), 1, wire.size(), this->out);
+  }
+  else {
+    for (uint32_t i = 0; i < (uint32_t)this->width * this->height; i++) {
+      this->rgb[i * 3] = pixels[i] >> 16;
+      this->rgb[i * 3 + 1] = pixels[i] >> 8;
+      this->rgb[i * 3 + 2] = pixels[i];
+    }
+    this->writeImage();
+  }
+  fflush(this->out);
+  this->frames++;
+}
+
+void FrameWriter::writeImage() {
+  if (this->format == FrameFormat::ANSI) {
+    this->writeAnsi();
+    return;
+  }
+  const uint16_t w = this->width * this->scale, h = this->height * this->scale;
+  for (uint16_t y = 0; y < h; y++)
+    for (uint16_t x = 0; x < w; x++)
+      memcpy(&this->scaled[(y * w + x) * 3], &this->rgb[((y / this->scale) * this->width + x / this->scale) * 3], 3);
+
+  if (this->format == FrameFormat::RGB) {
+    fwrite(this->scaled.data(), 1, this->scaled.size(), this->out);
+  }
+  else if (this->format == FrameFormat::PPM) {
+    fprintf(this->out, "P6\n%d %d\n255\n", w, h);
+    fwrite(this->scaled.data(), 1, this->scaled.size(), this->out);
+  }
+  else {  // Y4M, BT.601 studio range, planes one after the other
+    const uint32_t n = (uint32_t)w * h;
+    std::vector<uint8_t> yuv(n * 3);
+    for (uint32_t i = 0; i < n; i++) {
+      const int r = this->scaled[i * 3], g = this->scaled[i * 3 + 1], b = this->scaled[i * 3 + 2];
+      yuv[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+      yuv[n + i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+      yuv[2 * n + i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+    fprintf(this->out, "FRAME\n");
+    fwrite(yuv.data(), 1, yuv.size(), this->out);
+  }
+}
+
+void FrameWriter::writeAnsi() {
+  // Upper half block, the foreground color is the upper pixel and the background the lower one, which
+  // makes square pixels in most terminal fonts
+  fprintf(this->out, "\x1b[H");
+  for (uint16_t y = 0; y < this->height; y += 2) {
+    for (uint16_t x = 0; x < this->width; x++) {
+      const uint8_t *top = &this->rgb[(y * this->width + x) * 3];
+      fprintf(this->out, "\x1b[38;2;%d;%d;%dm", top[0], top[1], top[2]);
+      if (y + 1 < this->height) {
+        const uint8_t *bottom = top + this->width * 3;
+        fprintf(this->out, "\x1b[48;2;%d;%d;%dm", bottom[0], bottom[1], bottom[2]);
+      }
+      fprintf(this->out, "\xe2\x96\x80");
+    }
+    fprintf(this->out, "\x1b[0m\n");
+  }
+}
+
+bool FrameWriter::parseFormat(const char *name, FrameFormat &format) {
+  static const struct {const char *name; FrameFormat format;} FORMATS[] = {
+    {"wire", FrameFormat::WIRE}, {"rgb", FrameFormat::RGB}, {"ppm", FrameFormat::PPM}, {"y4m", FrameFormat::Y4M}, {"ansi", FrameFormat::ANSI}
+  };
+  for (const auto &f : FORMATS) {
+    if (strcmp(name, f.name) == 0) {
+      format = f.format;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,47 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+#include "canvas.h"
+
+enum class FrameFormat {
+  WIRE,  // The wire bytes as the LEDs get them : GRB, in LED order
+  RGB,  // Raw RGB24 frames, row-major (ffmpeg -f rawvideo -pix_fmt rgb24 -video_size WxH)
+  PPM,  // A binary PPM per frame, one after the other (ffmpeg -f image2pipe -c:v ppm)
+  Y4M,  // YUV4MPEG2 4:4:4 stream, that video players and ffmpeg read as is
+  ANSI  // Preview in a terminal with 24-bit colors, two pixels per character
+};
+
+// Writes the frames of the panel to a file or a pipe, either as the LEDs receive them (writeWire(), the
+// wire bytes mapped back to the panel through the layout table), or as the program drew them
+// (writeCanvas(), before brightness and current limiting). The image formats can be scaled up, as a
+// 16x16 video is hard to look at.
+class FrameWriter {
+  private:
+    const uint16_t width, height;
+    const uint16_t *const led_index;  // Row-major (x, y) -> LED table of the layout
+    const float framerate;
+    FILE *out = nullptr;
+    FrameFormat format;
+    uint8_t scale;
+    std::vector<uint8_t> rgb;  // Frame being written, row-major
+    std::vector<uint8_t> scaled;
+    std::atomic<uint32_t> frames{0};
+
+    void writeImage();
+    void writeAnsi();
+
+  public:
+    FrameWriter(uint16_t width, uint16_t height, const uint16_t *led_index, float framerate) :
+          width(width), height(height), led_index(led_index), framerate(framerate), rgb(width * height * 3) {};
+    void begin(FILE *out, FrameFormat format, uint8_t scale = 1);
+
+    void writeWire(const uint8_t *wire);  // 3 bytes per LED
+    void writeCanvas(const Canvas &canvas);  // Of the panel's size
+    uint32_t framesWritten() const {return this->frames;}
+
+    static bool parseFormat(const char *name, FrameFormat &format);
+};
+
+#endif
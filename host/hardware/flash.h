@@ -0,0 +1,18 @@
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+// Stand-in for the Pico SDK's flash API : the 2MB of flash are an image in RAM, erased to 0xff at start,
+// which XIP_BASE maps like the RP2040 maps the real one.
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+extern uint8_t host_flash_image[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)host_flash_image)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+// Stand-in for the Pico SDK's hardware/sync.h. There are no interrupts to disable on the host, and the
+// event of __wfe() and __sev() is a flag per core, behind a condition variable, see host_runtime.cpp.
+#include <stdint.h>
+
+static inline uint32_t save_and_disable_interrupts() {return 0;}
+static inline void restore_interrupts(uint32_t status) {}
+
+void __wfe();
+void __sev();
+
+#endif
@@ -0,0 +1,23 @@
+#include "host_led_output.h"
+#include "pico/time.h"
+
+bool HostLedOutput::startFrame(const uint8_t *wire, uint16_t num_bytes) {
+  if (this->busy())
+    return false;
+  this->writer.writeWire(wire);
+  const uint32_t frame_us = (uint64_t)num_bytes * 8 * 1000000 / BITS_PER_SECOND + LATCH_US;
+  this->wire_us += frame_us;
+  this->transfer_end = time_us_64() + (this->realtime ? frame_us : 0);
+  this->transferring = true;
+  return true;
+}
+
+bool HostLedOutput::busy() {
+  if (this->transferring && time_us_64() >= this->transfer_end) {
+    // The bytes were copied as soon as the frame started, the callback waits for the simulated
+    // wire so that the caller sees the same timing as on the panel.
+    this->transferring = false;
+    this->frameSent();
+  }
+  return this->transferring;
+}
@@ -0,0 +1,30 @@
+#ifndef HOST_LED_OUTPUT_H
+#define HOST_LED_OUTPUT_H
+#include "led_output.h"
+#include "frame_writer.h"
+
+// Output for running the programs on a computer : every frame goes to a FrameWriter as it is started,
+// and busy() holds for as long as the real strip would take to receive and latch it, on the host
+// runtime's clock. With realtime off the wire is infinitely fast, for rendering faster than the panel
+// could, and the simulated wire time is only accounted.
+class HostLedOutput : public LedOutput {
+  private:
+    static constexpr uint32_t BITS_PER_SECOND = 800000;
+    static constexpr uint32_t LATCH_US = 300;
+
+    FrameWriter &writer;
+    const bool realtime;
+    bool transferring = false;
+    uint64_t transfer_end;  // time_us_64()
+    uint64_t wire_us = 0;  // Total wire time of all the frames sent so far
+
+  public:
+    HostLedOutput(FrameWriter &writer, bool realtime = true) : writer(writer), realtime(realtime) {};
+    void begin() override {}
+    bool startFrame(const uint8_t *wire, uint16_t num_bytes) override;
+    bool busy() override;
+
+    uint64_t wireMicros() const {return this->wire_us;}
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "host_runtime.h"
+#include <Arduino.h>
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <new>
+#if defined(__SANITIZE_ADDRESS__)
+extern "C" size_t __sanitizer_get_current_allocated_bytes();  // Of sanitizer/allocator_interface.h, which GCC doesn't ship
+#endif
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+typedef std::chrono::steady_clock Clock;
+
+HostSerial Serial;
+HostRP2040 rp2040;
+uint8_t host_flash_image[PICO_FLASH_SIZE_BYTES];
+
+static std::atomic<uint64_t> simulated_us{0};
+static bool realtime = false;  // Only set before the threads start
+static double realtime_speed = 1;
+static Clock::time_point realtime_start;
+static uint64_t realtime_start_us;
+
+static std::mutex event_mutex;
+static std::condition_variable event_condition;
+static bool events[2];  // Event flag of each core
+static thread_local uint8_t current_core = 0;
+
+static FILE *serial_output = nullptr;
+static uint32_t pin_levels = 0xffffffff;  // One bit per pin
+
+static struct FlashInit {
+  FlashInit() {memset(host_flash_image, 0xff, sizeof(host_flash_image));}  // As a new chip
+} flash_init;
+
+void hostSetClock(uint64_t us) {
+  if (us > simulated_us)
+    simulated_us = us;
+}
+
+void hostRunInRealTime(double speed) {
+  realtime_start_us = simulated_us;
+  realtime_start = Clock::now();
+  realtime_speed = speed;
+  realtime = true;
+}
+
+bool hostIsRealTime() {
+  return realtime;
+}
+
+void hostSetCore(uint8_t core) {
+  current_core = core;
+}
+
+void hostSetSerialOutput(FILE *out) {
+  serial_output = out;
+}
+
+void hostSetPin(uint8_t pin, bool level) {
+  pin_levels = level ? pin_levels | (1u << pin) : pin_levels & ~(1u << pin);
+}
+
+// Real time at which the clock reaches us, when it follows the host's
+static Clock::time_point realTimeAt(uint64_t us) {
+  const double seconds = (int64_t)(us - realtime_start_us) / 1e6 / realtime_speed;
+  return realtime_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+uint64_t time_us_64() {
+  if (!realtime)
+    return simulated_us;
+  const double seconds = std::chrono::duration<double>(Clock::now() - realtime_start).count();
+  return realtime_start_us + (uint64_t)(seconds * realtime_speed * 1e6);
+}
+
+uint32_t time_us_32() {
+  return (uint32_t)time_us_64();
+}
+
+unsigned long millis() {
+  return (unsigned long)(time_us_64() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)time_us_64();
+}
+
+void delay(unsigned long ms) {
+  delayMicroseconds(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (realtime)
+    std::this_thread::sleep_until(realTimeAt(time_us_64() + us));
+  else
+    simulated_us += us;
+}
+
+void __sev() {
+  std::lock_guard<std::mutex> lock(event_mutex);
+  events[0] = events[1] = true;
+  event_condition.notify_all();
+}
+
+void __wfe() {
+  // The Pico also wakes up on any interrupt, so waiting at most a millisecond is as faithful, and a
+  // missing __sev() can't hang the host
+  std::unique_lock<std::mutex> lock(event_mutex);
+  event_condition.wait_for(lock, std::chrono::milliseconds(1), [] {return events[current_core];});
+  events[current_core] = false;
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+  if (!realtime) {  // Nothing else runs, the event can only be there already
+    std::lock_guard<std::mutex> lock(event_mutex);
+    if (events[current_core]) {
+      events[current_core] = false;
+      return false;
+    }
+    hostSetClock(timeout_timestamp);
+    return true;
+  }
+  std::unique_lock<std::mutex> lock(event_mutex);
+  const bool event = event_condition.wait_until(lock, realTimeAt(timeout_timestamp), [] {return events[current_core];});
+  events[current_core] = false;
+  return !event;
+}
+
+long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+  return min < max ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+  srand(seed);  // The programs call rand() directly, this makes them repeatable too
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+int digitalRead(uint8_t pin) {
+  return (pin_levels >> pin) & 1;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {}
+
+int analogRead(uint8_t pin) {
+  return 0;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode) {}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+  memset(host_flash_image + flash_offs, 0xff, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    host_flash_image[flash_offs + i] &= data[i];  // Programming can only clear bits
+}
+
+void HostSerial::format(const char *format, ...) {
+  if (!serial_output)
+    return;
+  va_list args;
+  va_start(args, format);
+  vfprintf(serial_output, format, args);
+  va_end(args);
+}
+
+// What's allocated with new is counted here, for getUsedHeap() : the statistics of malloc itself count the
+// blocks it keeps in its caches as used. Left to AddressSanitizer when it's on, which has its own operator
+// new, and counts.
+#if !defined(__SANITIZE_ADDRESS__)
+static std::atomic<int> heap_used{0};
+static constexpr size_t BLOCK_HEADER = alignof(max_align_t);  // Holds the size of the block
+
+void *operator new(size_t size) {
+  uint8_t *block = (uint8_t *)malloc(size + BLOCK_HEADER);
+  if (!block)
+    throw std::bad_alloc();
+  *(size_t *)block = size;
+  heap_used += size;
+  return block + BLOCK_HEADER;
+}
+
+void operator delete(void *memory) noexcept {
+  if (!memory)
+    return;
+  uint8_t *block = (uint8_t *)memory - BLOCK_HEADER;
+  heap_used -= *(size_t *)block;
+  free(block);
+}
+
+void *operator new[](size_t size) {return operator new(size);}
+void operator delete[](void *memory) noexcept {operator delete(memory);}
+void operator delete(void *memory, size_t size) noexcept {operator delete(memory);}
+void operator delete[](void *memory, size_t size) noexcept {operator delete(memory);}
+#endif
+
+int HostRP2040::getUsedHeap() {
+#if defined(__SANITIZE_ADDRESS__)
+  return __sanitizer_get_current_allocated_bytes();
+#else
+  return heap_used;
+#endif
+}
+
+size_t HostSerial::write(const uint8_t *data, size_t length) {
+  if (serial_output)
+    fwrite(data, 1, length, serial_output);
+  return length;
+}
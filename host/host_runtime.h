@@ -0,0 +1,22 @@
+#ifndef HOST_RUNTIME_H
+#define HOST_RUNTIME_H
+#include <stdio.h>
+#include <stdint.h>
+
+// What stands for the Pico when the sketch runs on the host : the clock behind millis(), micros() and
+// time_us_64(), the event flags of __wfe()/__sev(), the pins and the flash image.
+//
+// The clock is simulated : it starts at 0 and only moves when it is set, or when delay() and
+// best_effort_wfe_or_timeout() wait, so a single thread can render a frame in no time and jump to its
+// deadline, as fast as the host goes and always with the same timings. hostRunInRealTime() makes it
+// follow the host's clock instead, sped up by a factor, for running both cores on threads.
+
+void hostSetClock(uint64_t us);  // Simulated clock only, never goes backwards
+void hostRunInRealTime(double speed);  // From the current time on, speed simulated seconds per real second
+bool hostIsRealTime();
+
+void hostSetCore(uint8_t core);  // Core the calling thread stands for, 0 or 1, for __wfe()
+void hostSetSerialOutput(FILE *out);  // Where Serial prints go, nowhere if null
+void hostSetPin(uint8_t pin, bool level);  // Level digitalRead() returns, HIGH by default (pulled up)
+
+#endif
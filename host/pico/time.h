@@ -0,0 +1,12 @@
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+// Stand-in for the Pico SDK's timestamps, on the host runtime's clock (host_runtime.h)
+#include <stdint.h>
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64();
+static inline absolute_time_t from_us_since_boot(uint64_t us) {return us;}
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);  // true if the timeout was reached
+
+#endif
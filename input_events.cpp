@@ -0,0 +1,61 @@
+#include "input_events.h"
+
+// Position change for each (previous state << 2 | new state), 0 for no change or a skipped state.
+// Contact bounce goes back and forth between two states, so it cancels out.
+static const int8_t KNOB_DIRECTION[16] = {
+  0, -1, 1, 0,
+  1, 0, 0, -1,
+  -1, 0, 0, 1,
+  0, 1, -1, 0
+};
+
+void InputDecoder::push(InputEvent::Type type, uint32_t now_us) {
+  if (!this->events.push({type, now_us}))
+    this->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void InputDecoder::begin(uint8_t encoder_state, bool button_level, uint32_t now_us) {
+  this->encoder_state = encoder_state;
+  this->button_pressed = !button_level;
+  this->button_time = now_us;
+}
+
+void InputDecoder::encoderEdge(uint8_t encoder_state, uint32_t now_us) {
+  if (encoder_state == this->encoder_state)
+    return;
+  this->position += KNOB_DIRECTION[encoder_state | (this->encoder_state << 2)];
+  this->encoder_state = encoder_state;
+
+  int32_t detent;
+  switch (this->latch) {
+    case EncoderLatch::FOUR3:
+      if (encoder_state != 3)
+        return;
+      detent = this->position >> 2;
+      break;
+    case EncoderLatch::FOUR0:
+      if (encoder_state != 0)
+        return;
+      detent = this->position >> 2;
+      break;
+    case EncoderLatch::TWO03:
+      if (encoder_state != 0 && encoder_state != 3)
+        return;
+      detent = this->position >> 1;
+      break;
+  }
+  for (; this->detent < detent; this->detent++)  // Normally a single step, more if edges came too fast to be told apart
+    this->push(InputEvent::Type::CLOCKWISE, now_us);
+  for (; this->detent > detent; this->detent--)
+    this->push(InputEvent::Type::COUNTERCLOCKWISE, now_us);
+}
+
+void InputDecoder::buttonEdge(bool button_level, uint32_t now_us) {
+  // The first edge of a bounce is taken, the ones that follow within the debounce time are not
+  const bool pressed = !button_level;
+  if (pressed == this->button_pressed || now_us - this->button_time < this->debounce_us)
+    return;
+  this->button_pressed = pressed;
+  this->button_time = now_us;
+  this->push(pressed ? InputEvent::Type::BUTTON_PRESSED : InputEvent::Type::BUTTON_RELEASED, now_us);
+}
@@ -0,0 +1,60 @@
+#ifndef INPUT_EVENTS_H
+#define INPUT_EVENTS_H
+#include <stdint.h>
+#include <atomic>
+#include "spsc_ring.h"
+
+struct InputEvent {
+  enum class Type : uint8_t {
+    CLOCKWISE,
+    COUNTERCLOCKWISE,
+    BUTTON_PRESSED,
+    BUTTON_RELEASED
+  };
+  Type type;
+  uint32_t time_us;  // When the edge happened, on the microsecond clock
+};
+
+// Same detent positions as RotaryEncoder::LatchMode
+enum class EncoderLatch : uint8_t {
+  FOUR3,  // 4 steps, latch at state 3 only
+  FOUR0,  // 4 steps, latch at state 0
+  TWO03   // 2 steps, latch at states 0 and 3
+};
+
+// Decodes the edges of the rotary encoder and of its button, as they happen, into timestamped events
+// that the main loop drains once per frame : however long a frame takes, no step is lost.
+// encoderEdge() and buttonEdge() are meant to be called from the pin change interrupts, both from the
+// same interrupt context since they share the queue as its single producer. The decoding itself is the
+// same as RotaryEncoder::tick() and the button debounce is a lockout on the wall clock, so that it
+// also runs on the host, fed with synthetic edges.
+class InputDecoder {
+  private:
+    static constexpr uint8_t QUEUE_SIZE = 64;
+
+    const EncoderLatch latch;
+    const uint32_t debounce_us;
+    SpscRing<InputEvent, QUEUE_SIZE> events;
+    std::atomic<uint32_t> dropped{0};  // Events lost because the queue was full
+
+    // Only touched by the interrupt handlers
+    uint8_t encoder_state = 3;  // pin1 | pin2 << 1
+    int32_t position = 0;  // In encoder steps
+    int32_t detent = 0;  // In detents, where the last event was sent
+    bool button_pressed = false;
+    uint32_t button_time = 0;  // Last accepted button edge
+
+    void push(InputEvent::Type type, uint32_t now_us);
+
+  public:
+    InputDecoder(EncoderLatch latch, uint32_t debounce_us) : latch(latch), debounce_us(debounce_us) {};
+    void begin(uint8_t encoder_state, bool button_level, uint32_t now_us);  // Pin levels before the interrupts are on
+
+    void encoderEdge(uint8_t encoder_state, uint32_t now_us);  // Either encoder pin changed
+    void buttonEdge(bool button_level, uint32_t now_us);  // The button pin changed, LOW is pressed
+
+    bool pop(InputEvent &event) {return this->events.pop(event);}  // Main loop
+    uint32_t droppedEvents() const {return this->dropped.load(std::memory_order_relaxed);}
+};
+
+#endif
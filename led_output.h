@@ -0,0 +1,38 @@
+#ifndef LED_OUTPUT_H
+#define LED_OUTPUT_H
+#include <stdint.h>
+
+// Where the wire bytes of a frame go : the LED strip on the Pico, a file or a pipe on the host.
+// Sending is asynchronous, startFrame() returns straight away and the CPU is free while the frame is
+// clocked out. The bytes must stay untouched until the frame sent callback runs, and the next frame
+// can only start once busy() is false, which also covers the latch time the LEDs need to display it.
+class LedOutput {
+  public:
+    typedef void (*FrameSentCallback)(void *context);
+
+    virtual ~LedOutput() {}
+    virtual void begin() = 0;
+    // Starts sending num_bytes of wire (GRB, in LED order), false if the previous frame isn't done
+    virtual bool startFrame(const uint8_t *wire, uint16_t num_bytes) = 0;
+    virtual bool busy() = 0;
+    void waitForFrame() {while (this->busy());}
+
+    // Called once the output is done reading the bytes of the frame. It can run in an interrupt
+    // handler, on the core that called begin().
+    void onFrameSent(FrameSentCallback callback, void *context) {
+      this->frame_sent_callback = callback;
+      this->frame_sent_context = context;
+    }
+
+  protected:
+    void frameSent() {
+      if (this->frame_sent_callback)
+        this->frame_sent_callback(this->frame_sent_context);
+    }
+
+  private:
+    FrameSentCallback frame_sent_callback = nullptr;
+    void *frame_sent_context = nullptr;
+};
+
+#endif
@@ -1,16 +1,25 @@
 #include <math.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_NeoMatrix.h>
-#include <Adafruit_NeoPixel.h>
 #include <stdlib.h>
+#include <atomic>
+#include "canvas.h"
+#include "frame_pipeline.h"
+#include "frame_scheduler.h"
+#include "matrix_layout.h"
+#include "output_stage.h"
+#include "led_output.h"
+#ifdef ARDUINO_ARCH_RP2040
+#include "pio_led_output.h"
+#endif
 #include "utils.h"
-#include "ws2812_program.h"
-#include "RotaryEncoder.h"
-#include "ezButton.h"
+#include "program_registry.h"
+#include "input_events.h"
 #include "config_save.h"
+#include "frame_profiler.h"
+#include "telemetry.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
 //#include "MemoryFree.h"
 
-#define NUMBER_OF_PROGRAMS 22
 #define FRAMERATE 31  // Frames per second
 #define HEIGHT 16
 #define WIDTH 16
@@ -18,193 +27,289 @@
 #define MATRIX_VOLTAGE 5  // Volts
 #define MATRIX_CURRENT_DRAW_PER_CHANNEL 0.020  // Amperes
 #define MAX_CURRENT_DRAW 2.0 // Amperes
+#define MATRIX_GAMMA 1.0  // 1.0 keeps the channel values linear, as the programs were designed with
 #define ROT_ENC_BUTTON_PIN 0 
 #define ROTARY_ENC_DT_PIN 1
 #define ROT_ENC_CLK_PIN 2
+#define FRAME_BUFFERS 2  // Front buffer on the wire, back buffer being rendered
+#define OUTPUT_CHECK_INTERVAL 1000  // Microseconds core 1 sleeps at most while the LEDs latch a frame
+#define BUTTON_DEBOUNCE 20000  // Microseconds
+#define BUTTON_HOLDOFF 300000  // Microseconds after the last knob use during which the button is ignored
+#define ENCODER_HOLDOFF 100000  // Microseconds between two knob steps that are taken into account
+#define CONFIG_SAVE_DELAY 3000  // Milliseconds the knob must be left alone before the config is written to flash
+#define TELEMETRY_STATS_INTERVAL 100000  // Microseconds between two frame stats records on the serial port
+#define TELEMETRY_PROFILE_INTERVAL 2000000  // Microseconds between two frame profiles, when the profiler is built in
 
-Adafruit_NeoMatrix matrix = Adafruit_NeoMatrix(WIDTH, HEIGHT, NEOMATRIX_PIN,
-  NEO_MATRIX_TOP     + NEO_MATRIX_RIGHT +
-  NEO_MATRIX_COLUMNS + NEO_MATRIX_ZIGZAG,
-  NEO_GRB            + NEO_KHZ800);
-RotaryEncoder rotary_encoder(ROT_ENC_CLK_PIN, ROTARY_ENC_DT_PIN, RotaryEncoder::LatchMode::TWO03);
-ezButton button(ROT_ENC_BUTTON_PIN);  // create ezButton object that attach to pin 7;
-
-const float timestep = 1.0 / FRAMERATE;
-float brightness = 0.1f;
-unsigned long t0;
-unsigned long t1;
-unsigned long t2;
-double t = 0.0f;
-double time_of_last_encoder_use = 0.0f;
-float current_draw;
-RotaryEncoder::Direction rotary_encoder_direction;
-int selected_program = 0;
+typedef MatrixLayout<WIDTH, HEIGHT, LayoutOrigin::TOP_RIGHT, LayoutAxis::COLUMNS, true> PanelLayout;  // Wired in zigzagging columns, from the top right corner
+#ifdef ARDUINO_ARCH_RP2040
+PioLedOutput led_output(pio0, NEOMATRIX_PIN);
+#else
+extern LedOutput &led_output;  // Host build, given by host/firmware_host.cpp
+#endif
+Canvas canvas(WIDTH, HEIGHT);  // What the programs render into, copied to the matrix once per frame
+OutputStage output_stage(MATRIX_CURRENT_DRAW_PER_CHANNEL, MAX_CURRENT_DRAW, MATRIX_GAMMA);
+InputDecoder input_decoder(EncoderLatch::TWO03, BUTTON_DEBOUNCE);  // Fed by the pin interrupts of core 1
+PicoFlashBackend flash;
+ConfigStore config_store(flash, CONFIG_SAVE_DELAY);
+Telemetry telemetry(TELEMETRY_STATS_INTERVAL, TELEMETRY_PROFILE_INTERVAL);
+
+// Core 0 renders the frames, core 1 sends them to the LEDs and polls the inputs. A frame only goes from
+// one core to the other through the pipeline, so the renderer gets the whole frame time for iterate().
+struct Frame {
+  uint8_t wire[PanelLayout::size * 3];  // GRB bytes, in LED order
+  float current_draw;  // Amperes
+  uint32_t program_ram;  // Bytes taken by the program that rendered it
+  uint32_t render_time;  // Microseconds spent rendering the frame
+  uint64_t deadline;  // time_us_64() at which it must be shown
+  FrameScheduler::Stats stats;  // Of the scheduler, once the frame was rendered
+};
+Frame frames[FRAME_BUFFERS];
+FramePipeline<FRAME_BUFFERS> frame_pipeline;
+
+// Written by core 1 when the knob is used, read by core 0 for every frame
+std::atomic<int> selected_program{0};
+std::atomic<float> brightness{0.1f};
+std::atomic<bool> show_mode_indicator{false};  // The button was pressed, the next frame shows it
+std::atomic<bool> setup_done{false};  // Core 1 waits for setup() before starting the output
+std::atomic<bool> output_ready{false};  // and core 0 for the output before rendering
+
+// Core 0 only
+FrameScheduler frame_scheduler(FRAMERATE);
+ProgramArena program_arena;  // The program being rendered, the others aren't built
+int rendered_program = -1;
+uint32_t program_ram = 0;  // Bytes, of the program being rendered
+
+// Core 1 only
+uint32_t last_show_time = 0;  // Microseconds
+bool has_pending_frame = false;  // Rendered, waiting for its deadline
+uint8_t pending_frame;
+uint8_t sending_frame;  // Frame buffer on the wire, given back to the renderer once sent
+uint32_t frame_period = 0;  // Microseconds
+uint32_t time_of_last_encoder_use = 0;  // Microseconds, of the input event
 bool is_selecting_program = false;  // If true : selects the program. If false. Selects the brightness
-bool button_has_been_released = true;
-
-WS2812MatrixProgram *programs[NUMBER_OF_PROGRAMS];
-StaticProgram static_white_prog = StaticProgram(0, Adafruit_NeoMatrix::Color(255, 255, 255));
-StaticProgram static_warm_yellow_prog = StaticProgram(0, Adafruit_NeoMatrix::Color(255, 182, 78));
-StaticProgram static_red_prog = StaticProgram(0, Adafruit_NeoMatrix::Color(255, 0, 0));
-StaticProgram static_green_prog = StaticProgram(0, Adafruit_NeoMatrix::Color(0, 255, 0));
-StaticProgram static_blue_prog = StaticProgram(0, Adafruit_NeoMatrix::Color(0, 0, 255));
-SpectralProgram spectral_prog = SpectralProgram(0.025);
-RainbowWaveProgram rainbow_wave_prog = RainbowWaveProgram(0.2, 1);
-RainbowPlasmaProgram rainbow_plasma_prog = RainbowPlasmaProgram(.125, 15);
-FirePlasmaProgram fire_plasma_prog = FirePlasmaProgram(.125, 15);
-SpectralFirePlasmaProgram spectral_fire_plasma_prog = SpectralFirePlasmaProgram(.125, 15);
-PerlinFireProgram perlin_fire_prog = PerlinFireProgram(.5, 15, matrix.width(), matrix.height(), 3.5, 5);
-SpectralPerlinFireProgram spectral_perlin_fire_prog = SpectralPerlinFireProgram(.5, 15, matrix.width(), matrix.height(), 3.5, 5);
-FallingSandProgram falling_sand_prog = FallingSandProgram(1/3.0f, matrix.width(), matrix.height());
-LavaLampProgram lava_lamp_prog = LavaLampProgram(0.15, matrix.width(), matrix.height(), 11, 125);
-MatrixEffectProgram matrix_effect_prog = MatrixEffectProgram(1, matrix.width(), matrix.height());
-VortexProgram vortex_program = VortexProgram(1.0f);
-RotatingKaleidoscopeProgram rotating_kaleidoscope_prog = RotatingKaleidoscopeProgram(0.25);
-OctopusProgram octopus_prog = OctopusProgram(1.0f, matrix.height(), matrix.width());
-BurstsProgram bursts_prog = BurstsProgram(0.5f);
-LissajousProgram lissajous_prog = LissajousProgram(3.0f);
-DnaSpiralProgram dna_spiral_prog = DnaSpiralProgram(4.0f);
-TetrahedronProgram tetrahedron_prog = TetrahedronProgram(1.0f);
-
-void bootUpAnimation(Adafruit_NeoMatrix &matrix) {
-  matrix.fillScreen(0);
+
+void bootUpAnimation(Canvas &canvas, LedOutput &output) {
+  static uint8_t wire[PanelLayout::size * 3];
+  canvas.fill(0);
   const float wait_time = 25;
   for (float t = 0; t < 1; t += wait_time/1000.0f) {
-    matrix.fillScreen(ColorHSV(51000, 255, (uint8_t)(64*sin(t*3.14159))));
-    matrix.show();
+    canvas.fill(ColorHSV888(51000, 255, (uint8_t)(64*sin(t*3.14159))));
+    output.waitForFrame();  // The wire buffer is still being read until then
+    output_stage.render(canvas, PanelLayout::index.led, wire);
+    output.startFrame(wire, sizeof(wire));
     delay(wait_time);
   }
+  output.waitForFrame();
+}
+
+void frameSent(void *context) {  // DMA interrupt of core 1
+  frame_pipeline.release(sending_frame);
+  __sev();  // Wakes core 0 up if it's waiting for a buffer
+}
+
+void encoderInterrupt() {
+  input_decoder.encoderEdge(digitalRead(ROT_ENC_CLK_PIN) | (digitalRead(ROTARY_ENC_DT_PIN) << 1), time_us_32());
+}
+
+void buttonInterrupt() {
+  input_decoder.buttonEdge(digitalRead(ROT_ENC_BUTTON_PIN), time_us_32());
 }
 
 void setup() {
   randomSeed(micros() + analogRead(NEOMATRIX_PIN));
-  t += random(10000);
-
-  programs[0] = &static_white_prog;
-  programs[1] = &static_warm_yellow_prog;
-  programs[2] = &static_red_prog;
-  programs[3] = &static_green_prog;
-  programs[4] = &static_blue_prog;
-  programs[5] = &spectral_prog;
-  programs[6] = &rainbow_wave_prog;
-  programs[7] = &rainbow_plasma_prog;
-  programs[8] = &fire_plasma_prog;
-  programs[9] = &spectral_fire_plasma_prog;
-  programs[10] = &perlin_fire_prog;
-  programs[11] = &spectral_perlin_fire_prog;
-  programs[12] = &falling_sand_prog;
-  programs[13] = &lava_lamp_prog;
-  programs[14] = &matrix_effect_prog;
-  programs[15] = &vortex_program;
-  programs[16] = &rotating_kaleidoscope_prog;
-  programs[17] = &octopus_prog;
-  programs[18] = &bursts_prog;
-  programs[19] = &lissajous_prog;
-  programs[20] = &dna_spiral_prog;
-  programs[21] = &tetrahedron_prog;
-  
-
-  AppConfig* config = loadConfig();
-  brightness = config->brightness;
-  selected_program = config->selected_program;
-  brightness = max(0, min(1, brightness));
-  selected_program = max(0, min(NUMBER_OF_PROGRAMS - 1, selected_program));
-
-  matrix.begin();
-  matrix.setBrightness(255);
-
-  //bootUpAnimation(matrix);
-
-  matrix.fillScreen(0);
-  matrix.show();
+  const double start_time = random(10000);
+
+  AppConfig config = {0, 0.1f};  // Until a config is saved
+  config_store.load(config);
+  brightness = max(0, min(1, config.brightness));
+  selected_program = max(0, min(ProgramRegistry::knobSize() - 1, config.selected_program));
+
+  setup_done = true;
+  while (!output_ready)
+    tight_loop_contents();
+  frame_scheduler.start(time_us_64(), start_time);
+}
+
+void setup1() {
+  while (!setup_done)
+    tight_loop_contents();
+
+  led_output.begin();  // On this core, so that its interrupt is too
+  pinMode(ROT_ENC_CLK_PIN, INPUT_PULLUP);
+  pinMode(ROTARY_ENC_DT_PIN, INPUT_PULLUP);
+  pinMode(ROT_ENC_BUTTON_PIN, INPUT_PULLUP);
+  input_decoder.begin(digitalRead(ROT_ENC_CLK_PIN) | (digitalRead(ROTARY_ENC_DT_PIN) << 1), digitalRead(ROT_ENC_BUTTON_PIN), time_us_32());
+  attachInterrupt(digitalPinToInterrupt(ROT_ENC_CLK_PIN), encoderInterrupt, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ROTARY_ENC_DT_PIN), encoderInterrupt, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ROT_ENC_BUTTON_PIN), buttonInterrupt, CHANGE);
+
+  //bootUpAnimation(canvas, led_output);
+
+  static const uint8_t black[PanelLayout::size * 3] = {};
+  led_output.startFrame(black, sizeof(black));
+  led_output.waitForFrame();
+  led_output.onFrameSent(frameSent, NULL);
+  output_ready = true;
 }
 
 void loop() {
-  t0 = millis();
+  uint8_t f;
+  {
+    PROFILE_SCOPE(BUFFER_WAIT);
+    while (!frame_pipeline.acquire(f))  // Both buffers are still waiting to be sent, the renderer is a frame ahead
+      __wfe();  // Until core 1 is done sending one
+  }
+  PROFILE_SCOPE(RENDER);
+  Frame &frame = frames[f];
 
-  programs[selected_program]->iterate(matrix, t);
+  const int program = selected_program;
+  const bool new_program = program != rendered_program;
+  if (new_program) {  // Built from scratch, on a black canvas, in place of the one before
+    program_arena.load(program, WIDTH, HEIGHT);
+    canvas.fill(0);
+    rendered_program = program;
+  }
+  const uint32_t render_start = time_us_32();
+  {
+    PROFILE_SCOPE(ITERATE);
+    program_arena.get()->iterate(canvas, frame_scheduler.time());
+  }
+  if (new_program)  // Once it sized its buffers to the canvas
+    program_ram = program_arena.ramBytes();
+  if (show_mode_indicator.exchange(false)) {
+    canvas.drawPixel(0, 6, ColorHSV888(7000, 255, 128));
+    canvas.drawPixel(0, 7, ColorHSV888(7000, 255, 255));
+    canvas.drawPixel(1, 7, ColorHSV888(7000, 255, 128));
+    canvas.drawPixel(0, 8, ColorHSV888(7000, 255, 128));
+  }
+  if (telemetry.snapshotRequested())
+    telemetry.captureSnapshot(canvas);
 
-  matrixApplyBrightness(matrix, brightness);
-  current_draw = matrixCurrentDraw(matrix, MATRIX_CURRENT_DRAW_PER_CHANNEL);
-  if (current_draw > MAX_CURRENT_DRAW) {
-    brightness = brightness * (MAX_CURRENT_DRAW / current_draw) - 0.01;
-    matrixApplyBrightness(matrix, brightness);
+  output_stage.setBrightness(brightness);
+  {
+    PROFILE_SCOPE(OUTPUT_STAGE);
+    output_stage.render(canvas, PanelLayout::index.led, frame.wire);  // Also limits the current draw, without changing the brightness
   }
-  matrix.show();
-
-  t1 = millis();
-  t2 = millis();
-  while (timestep * 1000 - (t2 - t0) > 0){
-    button.loop();
-    if (button.isPressed() && button_has_been_released && (t - time_of_last_encoder_use) > 0.30f) {
-      button_has_been_released = false;
-      is_selecting_program = !is_selecting_program;
-      time_of_last_encoder_use = t;
-      matrix.drawPixel(0, 6, ColorHSV(7000, 255, 128));
-      matrix.drawPixel(0, 7, ColorHSV(7000, 255, 255));
-      matrix.drawPixel(1, 7, ColorHSV(7000, 255, 128));
-      matrix.drawPixel(0, 8, ColorHSV(7000, 255, 128));
-      matrix.show();
-    }
-    if (!button_has_been_released && !button.isPressed()) {
-      button_has_been_released = true;
-    }
+  frame.current_draw = output_stage.currentDraw();
+  frame.program_ram = program_ram;
+  frame.render_time = time_us_32() - render_start;
+  frame.deadline = frame_scheduler.deadline();
+  frame_scheduler.frameRendered(time_us_64());  // Moves on to the next deadline, skipping the ones already missed
+  frame.stats = frame_scheduler.getStats();
+  frame_pipeline.publish(f);
+  __sev();  // Wakes core 1 up if it's waiting for a frame
+  PROFILE_END_FRAME();
+}
 
-    rotary_encoder.tick();
-    rotary_encoder_direction = rotary_encoder.getDirection();
-    if (
-      rotary_encoder_direction != RotaryEncoder::Direction::NOROTATION
-      && (t - time_of_last_encoder_use) > 0.10f
-      ) {
-      if (is_selecting_program) {
-        matrix.fillScreen(0);
-        switch (rotary_encoder_direction) {
-          case RotaryEncoder::Direction::CLOCKWISE:
-            selected_program -= 1;
-            break;
-          case RotaryEncoder::Direction::COUNTERCLOCKWISE:
-            selected_program += 1;
-            break;
+void handleInputs() {  // Once per frame, every knob step and button press since the last frame
+  InputEvent event;
+  bool config_changed = false;
+  while (input_decoder.pop(event)) {
+    switch (event.type) {
+      case InputEvent::Type::BUTTON_PRESSED:
+        if (event.time_us - time_of_last_encoder_use > BUTTON_HOLDOFF) {
+          is_selecting_program = !is_selecting_program;
+          time_of_last_encoder_use = event.time_us;
+          show_mode_indicator = true;
         }
-        selected_program = (selected_program + NUMBER_OF_PROGRAMS) % NUMBER_OF_PROGRAMS;
-      }
-      else {
-        switch (rotary_encoder_direction) {
-          case RotaryEncoder::Direction::CLOCKWISE:
-            brightness /= 1.3;
-            break;
-          case RotaryEncoder::Direction::COUNTERCLOCKWISE:
-            brightness *= 1.3;
-            break;
+        break;
+      case InputEvent::Type::CLOCKWISE:
+      case InputEvent::Type::COUNTERCLOCKWISE:
+        if (event.time_us - time_of_last_encoder_use > ENCODER_HOLDOFF) {
+          const bool clockwise = event.type == InputEvent::Type::CLOCKWISE;
+          if (is_selecting_program) {
+            selected_program = (selected_program + (clockwise ? -1 : 1) + ProgramRegistry::knobSize()) % ProgramRegistry::knobSize();
+          }
+          else {
+            float new_brightness = clockwise ? brightness / 1.3 : brightness * 1.3;
+            brightness = max(0.01, min(1.0, new_brightness));
+          }
+          config_changed = true;
+          time_of_last_encoder_use = event.time_us;
         }
-        brightness = max(0.01, min(1.0, brightness));
-      }
-      AppConfig config;
-      config.selected_program = selected_program;
-      config.brightness = brightness;
-      saveConfig(config);
-      time_of_last_encoder_use = t;
+        break;
+      default:
+        break;
+    }
+  }
+  if (config_changed) {  // Only written to the flash once the knob has been left alone for a while
+    AppConfig config;
+    config.selected_program = selected_program;
+    config.brightness = brightness;
+    config_store.set(config, millis());
+  }
+}
+
+void loop1() {
+  if (!has_pending_frame)
+    has_pending_frame = frame_pipeline.receive(pending_frame);
+  const uint64_t now = time_us_64();
+  const bool can_send = has_pending_frame && !led_output.busy();
+  if (!can_send || now < frames[pending_frame].deadline) {
+    // Sleeps until the deadline of the frame, or until the output is checked again while it latches.
+    // A frame rendered or sent meanwhile wakes it up earlier, and so do the input interrupts.
+    uint64_t wake_up = now + OUTPUT_CHECK_INTERVAL;
+    if (can_send && frames[pending_frame].deadline < wake_up)
+      wake_up = frames[pending_frame].deadline;
+    best_effort_wfe_or_timeout(from_us_since_boot(wake_up));
+    return;
+  }
+  const uint8_t f = pending_frame;  // The renderer is late if the deadline passed, the frame goes out straight away
+  has_pending_frame = false;
+
+  const float current_draw = frames[f].current_draw;  // Read before sending, the buffer goes back to the renderer right after
+  const uint32_t render_time = frames[f].render_time;
+  const uint32_t frame_program_ram = frames[f].program_ram;
+  const FrameScheduler::Stats stats = frames[f].stats;
+
+  const uint32_t show_time = time_us_32();
+  frame_period = show_time - last_show_time;
+  last_show_time = show_time;
+  sending_frame = f;
+  {
+    PROFILE_SCOPE(SEND);
+    led_output.startFrame(frames[f].wire, sizeof(frames[f].wire));  // Returns straight away
+  }
+  {
+    PROFILE_SCOPE(INPUTS);
+    handleInputs();
+  }
+  {
+    PROFILE_SCOPE(CONFIG_SAVE);
+    // While the DMA sends the frame, which doesn't need the flash. The renderer is idle if it already
+    // rendered every other buffer : it waits for this one.
+    config_store.update(millis(), frame_pipeline.queued() == FRAME_BUFFERS - 1);
+  }
+  while (Serial.available() > 0) {
+    switch (Serial.read()) {
+      case 's':  // Snapshot of the next frame
+        telemetry.requestSnapshot();
+        break;
+#if FRAME_PROFILER
+      case 'p':  // Frame profile, straight away
+        telemetry.requestProfile();
+        break;
+      case 'r':  // Starts the profile over
+        frame_profiler.reset();
+        break;
+#endif
+      default:
+        break;
     }
-  t2 = millis();
   }
 
-  //delay(timestep * 1000 - (t1 - t0));
-
-  Serial.print(matrixCurrentDraw(matrix, MATRIX_CURRENT_DRAW_PER_CHANNEL)); Serial.print(" A | ");
-  Serial.print(matrixPowerDraw(matrix, MATRIX_CURRENT_DRAW_PER_CHANNEL, MATRIX_VOLTAGE)); Serial.print(" W | ");
-  char c[2];
-  sprintf(c, "%2d", t1 - t0);
-  Serial.print("Time spent in cycle : "); Serial.print(c); Serial.print("ms | ");
-  Serial.print(1000.0 / (millis() - t0)); Serial.print(" fps | ");
-  Serial.print("Brightness : "); Serial.print(brightness); Serial.print(" | ");
-  Serial.print("Program n° : "); Serial.print(selected_program); Serial.print(" | ");
-  if (is_selecting_program)
-    Serial.print("Mode : program selection | ");
-  else
-    Serial.print("Mode : brightness selection | ");
-  //Serial.print("Free RAM : "); Serial.print(freeMemory() / 1000); Serial.print("kB | ");
-  Serial.println("");
-
-
-  t += timestep;
+  PROFILE_SCOPE(TELEMETRY);
+  Telemetry::FrameStats frame_stats;  // All worked out already, by the renderer and the scheduler
+  frame_stats.frames = stats.frames;
+  frame_stats.render_us = render_time;
+  frame_stats.period_us = frame_period;
+  frame_stats.current_ma = current_draw * 1000;
+  frame_stats.power_mw = current_draw * MATRIX_VOLTAGE * 1000;
+  frame_stats.brightness = brightness.load() * 1000;
+  frame_stats.late_frames = stats.late_frames;
+  frame_stats.dropped_frames = stats.dropped_frames;
+  frame_stats.program = selected_program.load();
+  frame_stats.program_ram = frame_program_ram;
+  frame_stats.flags = is_selecting_program ? Telemetry::SELECTING_PROGRAM : 0;
+  telemetry.send(Serial, show_time, frame_stats);
 }
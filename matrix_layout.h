@@ -0,0 +1,54 @@
+#ifndef MATRIX_LAYOUT_H
+#define MATRIX_LAYOUT_H
+#include <stdint.h>
+
+// Describes how the LEDs of a panel are wired, the same way the NEO_MATRIX_* flags do, but
+// resolved at compile time: MatrixLayout<...>::index holds the LED number of every (x, y) of the
+// row-major canvas, so mapping a pixel to its LED is a single table load.
+//
+// Example, for the 16x16 panel wired NEO_MATRIX_TOP + NEO_MATRIX_RIGHT + NEO_MATRIX_COLUMNS + NEO_MATRIX_ZIGZAG :
+//   typedef MatrixLayout<16, 16, LayoutOrigin::TOP_RIGHT, LayoutAxis::COLUMNS, true> PanelLayout;
+
+enum class LayoutOrigin {TOP_LEFT, TOP_RIGHT, BOTTOM_LEFT, BOTTOM_RIGHT};  // Corner of the first LED
+enum class LayoutAxis {ROWS, COLUMNS};  // Whether consecutive LEDs run along rows or columns
+
+template <uint16_t W, uint16_t H, LayoutOrigin ORIGIN, LayoutAxis AXIS, bool ZIGZAG>
+class MatrixLayout {
+  static_assert(W > 0 && H > 0, "The panel can't be empty");
+  static_assert((uint32_t)W * H <= 65536, "LED indices are stored on 16 bits");
+
+  public:
+    static constexpr uint16_t width = W;
+    static constexpr uint16_t height = H;
+    static constexpr uint32_t size = (uint32_t)W * H;
+
+    // LED number of the pixel (x, y), (0, 0) being the top left of the canvas
+    static constexpr uint16_t ledIndex(uint16_t x, uint16_t y) {
+      const bool right = ORIGIN == LayoutOrigin::TOP_RIGHT || ORIGIN == LayoutOrigin::BOTTOM_RIGHT;
+      const bool bottom = ORIGIN == LayoutOrigin::BOTTOM_LEFT || ORIGIN == LayoutOrigin::BOTTOM_RIGHT;
+      const uint16_t col = right ? W - 1 - x : x;  // Distance from the first LED's corner
+      const uint16_t row = bottom ? H - 1 - y : y;
+      if (AXIS == LayoutAxis::COLUMNS) {
+        const uint16_t minor = (ZIGZAG && (col & 1)) ? H - 1 - row : row;  // Every other column runs backwards
+        return col * H + minor;
+      }
+      const uint16_t minor = (ZIGZAG && (row & 1)) ? W - 1 - col : col;  // Every other row runs backwards
+      return row * W + minor;
+    }
+
+    struct Table {
+      uint16_t led[W * H];
+      constexpr uint16_t operator[](uint32_t i) const {return led[i];}
+    };
+
+    // Row-major (x, y) -> LED table, generated by the compiler and stored in flash
+    static constexpr Table index = [] {
+      Table table = {};
+      for (uint16_t y = 0; y < H; y++)
+        for (uint16_t x = 0; x < W; x++)
+          table.led[y * W + x] = ledIndex(x, y);
+      return table;
+    }();
+};
+
+#endif
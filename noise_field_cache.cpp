@@ -0,0 +1,85 @@
+#include "noise_field_cache.h"
+#include <algorithm>
+#include "simplex_noise.h"
+#include "frame_profiler.h"
+
+NoiseFieldCache::NoiseFieldCache(float scale, float keyframe_interval, uint16_t build_frames) :
+  step(toQ16(1.0f / scale)), interval(keyframe_interval), build_frames(std::max(build_frames, (uint16_t)1)) {}
+
+void NoiseFieldCache::buildRows(uint8_t slot, uint16_t from, uint16_t to) {
+  const q48_16 z = toQ48(this->key_time[slot]);
+  for (int y = from; y < to; y++) {
+    SimplexNoise::fill3dFixed(this->scratch.data(), this->w, 1, 0, y * this->step + z, z, this->step, 0);
+    for (int x = 0; x < this->w; x++)
+      this->keyframes[slot][y * this->w + x] = std::min(std::max(this->scratch[x] >> 1, -32768), 32767);
+  }
+  this->counters.samples_evaluated += (to - from) * this->w;
+}
+
+void NoiseFieldCache::reset(float t) {
+  this->prev = 0;
+  this->next = 1;
+  this->building = 2;
+  this->key_time[this->prev] = t - this->interval;
+  this->key_time[this->next] = t;
+  this->key_time[this->building] = t + this->interval;
+  this->buildRows(this->prev, 0, this->h);
+  if (this->interval > 0)
+    this->buildRows(this->next, 0, this->h);
+  this->built_rows = 0;
+  this->counters.resets++;
+}
+
+void NoiseFieldCache::update(uint16_t width, uint16_t height, float t) {
+  PROFILE_SCOPE(NOISE);
+  this->counters.frames++;
+  if (width != this->w || height != this->h) {
+    this->w = width;
+    this->h = height;
+    for (int i = 0; i < 3; i++)
+      this->keyframes[i].assign(width * height, 0);
+    this->scratch.resize(width);
+    this->rows_per_frame = (height + this->build_frames - 1) / this->build_frames;
+    this->reset(t);
+  }
+
+  if (this->interval <= 0) {  // No cache, the previous slot is the field itself
+    this->key_time[this->prev] = t;
+    this->buildRows(this->prev, 0, this->h);
+    this->alpha = 0;
+    return;
+  }
+
+  const float display_time = t - this->interval;
+  if (display_time < this->key_time[this->prev] || display_time > this->key_time[this->building])
+    this->reset(t);  // Went back in time, or skipped more than a keyframe
+
+  while (display_time > this->key_time[this->next]) {  // Moving on to the next interval
+    if (this->built_rows < this->h) {
+      this->buildRows(this->building, this->built_rows, this->h);
+      this->counters.catch_ups++;
+    }
+    const uint8_t done = this->prev;
+    this->prev = this->next;
+    this->next = this->building;
+    this->building = done;
+    this->key_time[this->building] = this->key_time[this->next] + this->interval;
+    this->built_rows = 0;
+    this->counters.keyframes++;
+  }
+
+  const uint16_t until = std::min(this->built_rows + this->rows_per_frame, (int)this->h);
+  this->buildRows(this->building, this->built_rows, until);
+  this->built_rows = until;
+
+  const float frac = (display_time - this->key_time[this->prev]) / this->interval;
+  this->alpha = std::min(std::max(frac, 0.0f), 1.0f) * (1 << 12);
+}
+
+void NoiseFieldCache::row(uint16_t y, q16_16 *out) const {
+  const int16_t *a = this->keyframes[this->prev].data() + y * this->w;
+  const int16_t *b = this->keyframes[this->next].data() + y * this->w;
+  const int32_t alpha = this->alpha;
+  for (int x = 0; x < this->w; x++)  // Q15 difference times Q12 alpha, back to Q16
+    out[x] = (a[x] << 1) + (((b[x] - a[x]) * alpha) >> 11);
+}
@@ -0,0 +1,47 @@
+#ifndef NOISE_FIELD_CACHE_H
+#define NOISE_FIELD_CACHE_H
+#include <stdint.h>
+#include <vector>
+#include "fixed_point.h"
+
+// The plasma field, noise(x / scale, y / scale + t, t) with t the animation time times the speed,
+// evaluated at keyframes rather than every frame. Frames are interpolated between the two latest
+// keyframes, while the next one is built a fixed number of rows per frame, so no frame pays for a
+// whole field. The output lags by one keyframe interval, which is just a constant time offset.
+// Keyframes are built over build_frames frames, which should take less time than an interval.
+// A keyframe interval of 0 disables the cache, the field is then evaluated every frame.
+class NoiseFieldCache {
+  public:
+    struct Stats {
+      uint32_t frames = 0;
+      uint32_t samples_evaluated = 0;  // Noise samples computed, keyframes included
+      uint32_t keyframes = 0;
+      uint32_t catch_ups = 0;  // Keyframes that weren't done in time and were finished in one go
+      uint32_t resets = 0;  // Time discontinuities or size changes, that rebuilt everything
+    };
+
+    NoiseFieldCache(float scale, float keyframe_interval, uint16_t build_frames);
+    void update(uint16_t width, uint16_t height, float t);  // Once per frame, before reading rows
+    void row(uint16_t y, q16_16 *out) const;  // Row y of the field at the time of the last update
+    const Stats &stats() const {return this->counters;}
+
+  private:
+    const q16_16 step;
+    const float interval;
+    const uint16_t build_frames;
+    uint16_t w = 0, h = 0;
+    uint16_t rows_per_frame = 0;
+    // Keyframes are stored as Q1.15 to halve their size. Slot order rotates : prev, next, building
+    std::vector<int16_t> keyframes[3];
+    float key_time[3] = {};
+    uint8_t prev = 0, next = 1, building = 2;
+    uint16_t built_rows = 0;
+    uint16_t alpha = 0;  // Position between prev and next, out of 1 << 12
+    std::vector<q16_16> scratch;
+    Stats counters;
+
+    void buildRows(uint8_t slot, uint16_t from, uint16_t to);
+    void reset(float t);
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "output_stage.h"
+#include <math.h>
+
+OutputStage::OutputStage(float current_per_channel, float max_current, float gamma) :
+  gamma(gamma),
+  current_per_unit(current_per_channel / 255.0f),
+  channel_budget((uint32_t)(max_current / current_per_channel * 255.0f)) {
+  this->setBrightness(1.0f);
+}
+
+void OutputStage::setBrightness(float brightness) {
+  if (brightness == this->brightness)
+    return;
+  this->brightness = brightness;
+  for (int v = 0; v < 256; v++) {
+    this->lut[v] = (uint8_t)(pow(v / 255.0f, this->gamma) * brightness * 255.0f + 0.5f);
+  }
+}
+
+void OutputStage::render(const Canvas &canvas, const uint16_t *led_index, uint8_t *wire) {
+  const uint32_t *pixels = canvas.data();
+  const int n = canvas.numPixels();
+  uint32_t color, sum = 0;
+  uint8_t r, g, b;
+  uint8_t *led;
+  for (int i = 0; i < n; i++) {
+    color = pixels[i];
+    r = this->lut[(color >> 16) & 0xff];
+    g = this->lut[(color >> 8) & 0xff];
+    b = this->lut[color & 0xff];
+    sum += r + g + b;
+    led = wire + 3 * led_index[i];
+    led[0] = g;
+    led[1] = r;
+    led[2] = b;
+  }
+  this->channel_sum = sum;
+
+  if (sum <= this->channel_budget) {
+    this->gain = 256;
+    return;
+  }
+  // Over budget : scaling this frame down. Rare enough that a second pass over the wire bytes is cheaper than limiting per pixel.
+  this->gain = (uint16_t)(((uint64_t)this->channel_budget << 8) / sum);
+  for (int i = 0; i < 3 * n; i++) {
+    wire[i] = (wire[i] * this->gain) >> 8;
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef OUTPUT_STAGE_H
+#define OUTPUT_STAGE_H
+#include <Arduino.h>
+#include "canvas.h"
+
+// Turns the canvas into the bytes sent to the LEDs, in a single pass per frame : every channel goes
+// through a brightness x gamma lookup table, the current the frame will draw is summed on the way,
+// and the result is written in GRB wire order at the LED's position given by the layout table.
+// If the frame draws more than the allowed current, it is scaled down by a gain that only applies to
+// that frame, the brightness setting itself is never touched.
+class OutputStage {
+  private:
+    uint8_t lut[256];
+    float brightness = -1.0f;  // Brightness the LUT was built for
+    const float gamma;
+    const float current_per_unit;  // Amperes drawn per unit of channel value (1/255 of a fully lit channel)
+    const uint32_t channel_budget;  // Highest sum of all channel values that stays within the allowed current
+    uint32_t channel_sum = 0;  // Sum of all channel values of the last frame, before limiting
+    uint16_t gain = 256;  // Limiter gain applied to the last frame, 256 being 1.0
+
+  public:
+    OutputStage(float current_per_channel, float max_current, float gamma = 1.0f);
+    void setBrightness(float brightness);  // Rebuilds the LUT, only if the brightness changed
+    void render(const Canvas &canvas, const uint16_t *led_index, uint8_t *wire);  // wire holds 3 bytes per LED
+
+    float requestedCurrentDraw() const {return this->channel_sum * this->current_per_unit;}  // Amperes, before limiting
+    float currentDraw() const {return this->requestedCurrentDraw() * this->limiterGain();}  // Amperes, actually drawn
+    float limiterGain() const {return this->gain / 256.0f;}
+};
+
+#endif
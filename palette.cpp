@@ -0,0 +1,83 @@
+#include "palette.h"
+#include "utils.h"
+#include "frame_profiler.h"
+
+static constexpr uint32_t expand565(uint16_t color565) {  // Same rounding as color565To888
+  return ((uint32_t)(((((color565 >> 11) & 0x1F) * 527) + 23) >> 6) << 16)
+    | ((uint32_t)(((((color565 >> 5) & 0x3F) * 259) + 33) >> 6) << 8)
+    | (uint32_t)((((color565 & 0x1F) * 527) + 23) >> 6);
+}
+
+static constexpr uint8_t lerp8(uint8_t a, uint8_t b, uint16_t frac) {  // frac out of 256
+  return (a * (256 - frac) + b * frac + 128) >> 8;
+}
+
+// Spreads the stops evenly over the 256 entries, interpolating linearly between them
+template <size_t N>
+static constexpr Palette gradient565(const uint16_t (&stops)[N]) {
+  Palette palette = {};
+  for (int i = 0; i < 256; i++) {
+    const uint32_t pos = i * (N - 1) * 256 / 255;  // Position along the stops, 8 bits of fraction
+    const uint32_t a = expand565(stops[pos >> 8]);
+    const uint32_t b = expand565(stops[(pos >> 8) + 1 < N ? (pos >> 8) + 1 : N - 1]);
+    const uint16_t frac = pos & 0xff;
+    palette.color[i] = ((uint32_t)lerp8(a >> 16, b >> 16, frac) << 16)
+      | ((uint32_t)lerp8((a >> 8) & 0xff, (b >> 8) & 0xff, frac) << 8)
+      | lerp8(a & 0xff, b & 0xff, frac);
+  }
+  return palette;
+}
+
+// Stops are packed as 0xHHSSVV, with an 8 bits hue
+template <size_t N>
+static constexpr HSVPalette gradientHSV(const uint32_t (&stops)[N]) {
+  HSVPalette palette = {};
+  for (int i = 0; i < 256; i++) {
+    const uint32_t pos = i * (N - 1) * 256 / 255;
+    const uint32_t a = stops[pos >> 8];
+    const uint32_t b = stops[(pos >> 8) + 1 < N ? (pos >> 8) + 1 : N - 1];
+    const uint16_t frac = pos & 0xff;
+    palette.hue[i] = lerp8(a >> 16, b >> 16, frac) * 257;  // 0..255 to 0..65535
+    palette.sat[i] = lerp8((a >> 8) & 0xff, (b >> 8) & 0xff, frac);
+    palette.val[i] = lerp8(a & 0xff, b & 0xff, frac);
+  }
+  return palette;
+}
+
+static constexpr uint16_t FIRE_STOPS_565[37] = {
+  0x0000, 0x1820, 0x2860, 0x4060, 0x50A0, 0x60E0, 0x70E0,
+  0x8920, 0x9960, 0xA9E0, 0xBA20, 0xC220, 0xDA60, 0xDAA0,
+  0xDAA0, 0xD2E0, 0xD2E0, 0xD321, 0xCB61, 0xCBA1, 0xCBE1,
+  0xCC22, 0xC422, 0xC462, 0xC4A3, 0xBCE3, 0xBCE3, 0xBD24,
+  0xBD24, 0xBD65, 0xB565, 0xB5A5, 0xB5A6, 0xCE6D, 0xDEF3,
+  0xEF78, 0xFFFF,
+};
+
+static constexpr uint16_t LAVA_STOPS_565[8] = {
+  0xC220, 0xD321, 0xCBA1, 0xCC22,
+  0xC462, 0xBCE3, 0xBD24, 0xBD65
+};
+
+static constexpr uint32_t SPECTRAL_FIRE_STOPS_HSV[37] = {
+  0x000000, 0x07ff18, 0x0cff28, 0x07ff40, 0x0aff50, 0x0cff60, 0x0aff70,
+  0x0bff88, 0x0cff98, 0x0fffa8, 0x0fffb8, 0x0fffc0, 0x0effd8, 0x10ffd8,
+  0x10ffd8, 0x12ffd0, 0x12ffd0, 0x13f5d0, 0x16f4c8, 0x17f4c8, 0x19f4c8,
+  0x1aeac8, 0x1ce9c0, 0x1de9c0, 0x1fdfc0, 0x23ddb8, 0x23ddb8, 0x24d2b8,
+  0x24d2b8, 0x26c7b8, 0x29c5b0, 0x2bc6b4, 0x2bbbb4, 0x2c7dcc, 0x2d4edc,
+  0x2e2fec, 0x5504fc
+};
+
+constexpr Palette FIRE_PALETTE = gradient565(FIRE_STOPS_565);
+constexpr Palette LAVA_PALETTE = gradient565(LAVA_STOPS_565);
+constexpr HSVPalette SPECTRAL_FIRE_PALETTE = gradientHSV(SPECTRAL_FIRE_STOPS_HSV);
+
+void HueRotatedPalette::rotate(uint16_t hue_shift) {
+  PROFILE_SCOPE(PALETTE);
+  if (this->built && hue_shift == this->hue_shift)
+    return;
+  for (int i = 0; i < 256; i++)
+    this->hue[i] = this->source.hue[i] + hue_shift;  // Wraps around the color wheel
+  ColorHSVBatch(this->hue, this->source.sat, this->source.val, this->palette.color, 256);
+  this->hue_shift = hue_shift;
+  this->built = true;
+}
@@ -0,0 +1,48 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+#include <Arduino.h>
+#include "fixed_point.h"
+
+// 256-entry RGB888 gradient, so that looking a color up is a single indexed load. The built-in
+// palettes are generated at compile time from a few color stops and are const, so they stay in flash.
+struct Palette {
+  uint32_t color[256];
+
+  uint32_t operator[](uint8_t index) const {return this->color[index];}
+  static uint8_t index(float value) {  // Maps 0..1 to the palette, clamping whatever falls outside
+    return value <= 0.0f ? 0 : value >= 1.0f ? 255 : (uint8_t)(value * 255 + 0.5f);
+  }
+  static uint8_t indexFixed(q16_16 value) {  // Same, from Q16.16
+    return value <= 0 ? 0 : value >= Q16_ONE ? 255 : (uint8_t)((value * 255 + Q16_ONE / 2) >> 16);
+  }
+};
+
+// Same, as hue/saturation/value, for the palettes that get their hue rotated at run time
+struct HSVPalette {
+  uint16_t hue[256];
+  uint8_t sat[256];
+  uint8_t val[256];
+};
+
+extern const Palette FIRE_PALETTE;  // Black to red, orange and white
+extern const Palette LAVA_PALETTE;  // Orange shades
+extern const HSVPalette SPECTRAL_FIRE_PALETTE;  // Fire in HSV, meant to be rotated through the spectrum
+
+// RAM copy of an HSVPalette with its hue shifted, rebuilt once per frame with the batch HSV conversion
+// rather than converting every pixel.
+class HueRotatedPalette {
+  private:
+    const HSVPalette &source;
+    Palette palette;
+    uint16_t hue_shift = 0;
+    bool built = false;
+    uint16_t hue[256];
+
+  public:
+    HueRotatedPalette(const HSVPalette &source) : source(source) {};
+    void rotate(uint16_t hue_shift);  // Only rebuilds if the shift changed
+    uint32_t operator[](uint8_t index) const {return this->palette[index];}
+    const Palette &rotated() const {return this->palette;}
+};
+
+#endif
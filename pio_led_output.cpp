@@ -0,0 +1,81 @@
+#ifdef ARDUINO_ARCH_RP2040
+#include "pio_led_output.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "hardware/timer.h"
+
+// ws2812.pio from the pico-examples, assembled :
+//   .side_set 1
+//   .wrap_target
+//   bitloop:
+//     out x, 1       side 0 [T3 - 1]  ; Side-set still takes place when instruction stalls
+//     jmp !x do_zero side 1 [T1 - 1]  ; Branch on the bit we shifted out. Positive pulse
+//   do_one:
+//     jmp  bitloop   side 1 [T2 - 1]  ; Continue driving high, for a long pulse
+//   do_zero:
+//     nop            side 0 [T2 - 1]  ; Or drive low, for a short pulse
+//   .wrap
+static const uint8_t T1 = 2, T2 = 5, T3 = 3;  // Cycles of each phase of a bit
+static const uint16_t ws2812_instructions[] = {0x6221, 0x1123, 0x1400, 0xa442};
+static const pio_program_t ws2812_program = {ws2812_instructions, 4, -1};
+
+PioLedOutput *PioLedOutput::dma_outputs[NUM_DMA_CHANNELS] = {};
+
+void PioLedOutput::dmaIrqHandler() {
+  for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+    PioLedOutput *output = dma_outputs[channel];
+    if (output == nullptr || !dma_channel_get_irq0_status(channel))
+      continue;
+    dma_channel_acknowledge_irq0(channel);
+    output->transfer_end = time_us_32();
+    output->transferring = false;
+    output->frameSent();
+  }
+}
+
+void PioLedOutput::begin() {
+  const uint offset = pio_add_program(this->pio, &ws2812_program);
+  this->sm = pio_claim_unused_sm(this->pio, true);
+  pio_gpio_init(this->pio, this->pin);
+  pio_sm_set_consistent_pindirs(this->pio, this->sm, this->pin, 1, true);
+
+  pio_sm_config config = pio_get_default_sm_config();
+  sm_config_set_wrap(&config, offset, offset + 3);
+  sm_config_set_sideset(&config, 1, false, false);
+  sm_config_set_sideset_pins(&config, this->pin);
+  // The DMA writes single bytes, which the bus replicates over the whole FIFO word : shifting out
+  // the 8 most significant bits sends the byte, MSB first as the WS2812 wants it.
+  sm_config_set_out_shift(&config, false, true, 8);
+  sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+  sm_config_set_clkdiv(&config, clock_get_hz(clk_sys) / (float)(BITS_PER_SECOND * (T1 + T2 + T3)));
+  pio_sm_init(this->pio, this->sm, offset, &config);
+  pio_sm_set_enabled(this->pio, this->sm, true);
+
+  this->dma_channel = dma_claim_unused_channel(true);
+  dma_channel_config dma_config = dma_channel_get_default_config(this->dma_channel);
+  channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_8);
+  channel_config_set_read_increment(&dma_config, true);
+  channel_config_set_write_increment(&dma_config, false);
+  channel_config_set_dreq(&dma_config, pio_get_dreq(this->pio, this->sm, true));
+  dma_channel_configure(this->dma_channel, &dma_config, &this->pio->txf[this->sm], NULL, 0, false);
+
+  dma_outputs[this->dma_channel] = this;
+  irq_add_shared_handler(DMA_IRQ_0, dmaIrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  dma_channel_set_irq0_enabled(this->dma_channel, true);
+  irq_set_enabled(DMA_IRQ_0, true);
+  this->transfer_end = time_us_32();
+}
+
+bool PioLedOutput::startFrame(const uint8_t *wire, uint16_t num_bytes) {
+  if (this->busy())
+    return false;
+  this->transferring = true;
+  dma_channel_transfer_from_buffer_now(this->dma_channel, wire, num_bytes);
+  return true;
+}
+
+bool PioLedOutput::busy() {
+  return this->transferring || time_us_32() - this->transfer_end < DRAIN_US + LATCH_US;
+}
+#endif
@@ -0,0 +1,34 @@
+#ifndef PIO_LED_OUTPUT_H
+#define PIO_LED_OUTPUT_H
+#include <Arduino.h>
+#include "hardware/pio.h"
+#include "led_output.h"
+
+// WS2812 output of the RP2040 : a PIO state machine generates the 800 kHz waveform, and a DMA channel
+// feeds it the wire bytes, so sending a frame takes no CPU time at all (Adafruit_NeoPixel::show()
+// pushes every byte from the CPU, with interrupts disabled for the whole transfer).
+class PioLedOutput : public LedOutput {
+  private:
+    static constexpr uint32_t BITS_PER_SECOND = 800000;
+    // Once the DMA is done, the FIFO (8 bytes, joined) and the output shift register are still to go out
+    static constexpr uint32_t DRAIN_US = 9 * 8 * 1000000 / BITS_PER_SECOND;
+    static constexpr uint32_t LATCH_US = 300;  // Low time that makes the LEDs display the frame, 280us for the newer WS2812B
+
+    PIO pio;
+    const uint8_t pin;
+    uint sm;
+    int dma_channel = -1;
+    volatile bool transferring = false;
+    volatile uint32_t transfer_end;  // time_us_32() when the DMA finished
+
+    static PioLedOutput *dma_outputs[NUM_DMA_CHANNELS];
+    static void dmaIrqHandler();
+
+  public:
+    PioLedOutput(PIO pio, uint8_t pin) : pio(pio), pin(pin) {};  // Touches no hardware, so it can be a global
+    void begin() override;
+    bool startFrame(const uint8_t *wire, uint16_t num_bytes) override;
+    bool busy() override;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "program_registry.h"
+#include <Arduino.h>
+#include <string.h>
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#endif
+
+// Zero initialized before any static constructor runs, so the registrations may come in any order
+const ProgramRegistry::Entry *ProgramRegistry::entries[ProgramRegistry::MAX_PROGRAMS];
+uint8_t ProgramRegistry::count;
+uint8_t ProgramRegistry::knob_count;
+
+void ProgramRegistry::add(const Entry &entry) {
+  if (count == MAX_PROGRAMS)
+    return;
+  // The knob programs come first : the host ones after them move up by one
+  const uint8_t index = entry.on_knob ? knob_count++ : count;
+  for (uint8_t i = count; i > index; i--)
+    entries[i] = entries[i - 1];
+  entries[index] = &entry;
+  count++;
+}
+
+int ProgramRegistry::find(const char *name) {
+  for (uint8_t i = 0; i < count; i++)
+    if (strcmp(entries[i]->name, name) == 0)
+      return i;
+  return -1;
+}
+
+WS2812MatrixProgram *ProgramArena::load(uint8_t index, uint16_t width, uint16_t height) {
+  this->unload();
+  this->entry = &ProgramRegistry::get(index);
+  this->heap_before = rp2040.getUsedHeap();
+#if defined(__SANITIZE_ADDRESS__)  // Past the program object, for the host tools to catch overruns as they would on the heap
+  ASAN_POISON_MEMORY_REGION(this->memory + this->entry->state_size, PROGRAM_ARENA_SIZE - this->entry->state_size);
+#endif
+  this->program = this->entry->construct(this->memory, width, height);
+  return this->program;
+}
+
+void ProgramArena::unload() {
+  if (!this->program)
+    return;
+  this->program->~WS2812MatrixProgram();  // Built in place, its memory stays
+#if defined(__SANITIZE_ADDRESS__)
+  ASAN_UNPOISON_MEMORY_REGION(this->memory, PROGRAM_ARENA_SIZE);
+#endif
+  this->program = nullptr;
+  this->entry = nullptr;
+}
+
+uint32_t ProgramArena::ramBytes() const {
+  if (!this->entry)
+    return 0;
+  const int heap = rp2040.getUsedHeap() - this->heap_before;
+  return this->entry->state_size + (heap > 0 ? heap : 0);
+}
@@ -0,0 +1,82 @@
+#ifndef PROGRAM_REGISTRY_H
+#define PROGRAM_REGISTRY_H
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include "ws2812_program.h"
+
+// Every program, registered by name with how to build it for a panel, in programs.cpp :
+//   REGISTER_PROGRAM("lava_lamp", LavaLampProgram, 0.15, 31, width, height, 11, 125);
+// None of them exists until it's selected : the selected one is built into a ProgramArena, and
+// destroyed when another one is, so only its state takes RAM, whatever the number of programs.
+#define PROGRAM_ARENA_SIZE 2048  // Bytes, of the largest program object. What it allocates is on the heap
+
+class ProgramRegistry {
+  public:
+    typedef WS2812MatrixProgram *(*Constructor)(void *memory, uint16_t width, uint16_t height);
+    struct Entry {
+      const char *name;
+      uint16_t state_size;  // Bytes of the program object
+      Constructor construct;  // Builds it at memory, which has PROGRAM_ARENA_SIZE bytes
+      bool on_knob;  // The knob goes through these ones, the others are only built by the host tools
+    };
+    static constexpr uint8_t MAX_PROGRAMS = 64;
+
+  private:
+    // Filled by the static constructors of programs.cpp, the knob programs first, in their registration order
+    static const Entry *entries[MAX_PROGRAMS];
+    static uint8_t count, knob_count;
+
+  public:
+    static void add(const Entry &entry);
+    static uint8_t size() {return count;}
+    static uint8_t knobSize() {return knob_count;}  // The knob programs are the first ones
+    static const Entry &get(uint8_t index) {return *entries[index];}
+    static int find(const char *name);  // Index, -1 if there's no such program
+};
+
+template <typename Program> class ProgramRegistration {
+  static_assert(sizeof(Program) <= PROGRAM_ARENA_SIZE, "The program doesn't fit in the arena, PROGRAM_ARENA_SIZE is too small");
+  static_assert(alignof(Program) <= alignof(max_align_t), "The program needs a stricter alignment than the arena's");
+
+  private:
+    const ProgramRegistry::Entry entry;
+
+  public:
+    ProgramRegistration(const char *name, bool on_knob, ProgramRegistry::Constructor construct) : entry{name, sizeof(Program), construct, on_knob} {
+      ProgramRegistry::add(this->entry);
+    }
+};
+
+#define PROGRAM_REGISTRY_CONCAT_(a, b) a##b
+#define PROGRAM_REGISTRY_CONCAT(a, b) PROGRAM_REGISTRY_CONCAT_(a, b)
+#define REGISTER_PROGRAM_(name, on_knob, Program, ...) \
+  static ProgramRegistration<Program> PROGRAM_REGISTRY_CONCAT(program_registration_, __LINE__)(name, on_knob, \
+    [](void *memory, uint16_t width, uint16_t height) -> WS2812MatrixProgram * {return new (memory) Program(__VA_ARGS__);})
+// The arguments are those of the constructor, and can use the width and height of the panel
+#define REGISTER_PROGRAM(name, Program, ...) REGISTER_PROGRAM_(name, true, Program, __VA_ARGS__)
+#define REGISTER_HOST_PROGRAM(name, Program, ...) REGISTER_PROGRAM_(name, false, Program, __VA_ARGS__)
+
+// Where the selected program lives
+class ProgramArena {
+  private:
+    alignas(max_align_t) uint8_t memory[PROGRAM_ARENA_SIZE];
+    WS2812MatrixProgram *program = nullptr;
+    const ProgramRegistry::Entry *entry = nullptr;
+    int heap_before = 0;  // Used heap before the program was built
+
+  public:
+    ProgramArena() {};
+    ProgramArena(const ProgramArena &) = delete;
+    ~ProgramArena() {this->unload();}
+
+    WS2812MatrixProgram *load(uint8_t index, uint16_t width, uint16_t height);  // Destroys the program loaded before
+    void unload();
+    WS2812MatrixProgram *get() const {return this->program;}
+    const ProgramRegistry::Entry *loaded() const {return this->entry;}
+    // Of the program loaded : its object and what the heap grew by since it was built. Once it has run a
+    // frame, as some programs size their buffers to the canvas then
+    uint32_t ramBytes() const;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "program_registry.h"
+
+// The knob goes through the programs in this order, which is also the one of the program number saved
+// in the config : new programs go at the end.
+REGISTER_PROGRAM("static_white", StaticProgram, 0, Canvas::Color(255, 255, 255));
+REGISTER_PROGRAM("static_warm_yellow", StaticProgram, 0, Canvas::Color(255, 182, 78));
+REGISTER_PROGRAM("static_red", StaticProgram, 0, Canvas::Color(255, 0, 0));
+REGISTER_PROGRAM("static_green", StaticProgram, 0, Canvas::Color(0, 255, 0));
+REGISTER_PROGRAM("static_blue", StaticProgram, 0, Canvas::Color(0, 0, 255));
+REGISTER_PROGRAM("spectral", SpectralProgram, 0.025);
+REGISTER_PROGRAM("rainbow_wave", RainbowWaveProgram, 0.2, 1);
+REGISTER_PROGRAM("rainbow_plasma", RainbowPlasmaProgram, .125, 15);
+REGISTER_PROGRAM("fire_plasma", FirePlasmaProgram, .125, 15);
+REGISTER_PROGRAM("spectral_fire_plasma", SpectralFirePlasmaProgram, .125, 15);
+REGISTER_PROGRAM("perlin_fire", PerlinFireProgram, .5, 15, 15, width, height, 3.5, 5);
+REGISTER_PROGRAM("spectral_perlin_fire", PerlinFireProgram, .5, 15, 15, width, height, 3.5, 5, PerlinFireProgram::SPECTRAL);
+REGISTER_PROGRAM("falling_sand", FallingSandProgram, 1/3.0f, 10, width, height);
+REGISTER_PROGRAM("lava_lamp", LavaLampProgram, 0.15, 31, width, height, 11, 125);
+REGISTER_PROGRAM("matrix_effect", MatrixEffectProgram, 1, width, height);
+REGISTER_PROGRAM("vortex", VortexProgram, 1.0f);
+REGISTER_PROGRAM("rotating_kaleidoscope", RotatingKaleidoscopeProgram, 0.25);
+REGISTER_PROGRAM("octopus", OctopusProgram, 1.0f, height, width);
+REGISTER_PROGRAM("bursts", BurstsProgram, 0.5f);
+REGISTER_PROGRAM("lissajous", LissajousProgram, 3.0f);
+REGISTER_PROGRAM("dna_spiral", DnaSpiralProgram, 4.0f);
+REGISTER_PROGRAM("tetrahedron", TetrahedronProgram, 1.0f);
+REGISTER_PROGRAM("life", LifeProgram, 0.05, 8, width, height);
+
+// Not on the knob yet
+REGISTER_HOST_PROGRAM("ripples", RipplesProgram, 1.0f);  // Drawn for a 16x16 panel whatever its size
+REGISTER_HOST_PROGRAM("stretchy_tetrahedron", StretchyTetrahedronProgram, 1.0f);
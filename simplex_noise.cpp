@@ -26,7 +26,18 @@
 
 #include "simplex_noise.h"
 
-#include <Arduino.h>  // int32_t/uint8_t
+#include <stdint.h>  // int32_t/uint8_t
+#include "frame_profiler.h"
+#if GRID_BOUNDS_CHECK
+#include <Arduino.h>
+
+static void printOutOfRange(float coordinate) {
+    Serial.print("Noise coordinate out of range : ");
+    Serial.println(coordinate);
+}
+
+NoiseRangeHandler noise_range_handler = printOutOfRange;
+#endif
 
 /**
  * Computes the largest integer value not greater than the float one
@@ -172,7 +183,7 @@ static float grad(int32_t hash, float x, float y, float z) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x) {
+float SimplexNoise::noiseFloat(float x) {
     float n0, n1;   // Noise contributions from the two "corners"
 
     // No need to skew the input space in 1D
@@ -211,7 +222,7 @@ float SimplexNoise::noise(float x) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y) {
+float SimplexNoise::noiseFloat(float x, float y) {
     float n0, n1, n2;   // Noise contributions from the three corners
 
     // Skewing/Unskewing factors for 2D
@@ -299,7 +310,7 @@ float SimplexNoise::noise(float x, float y) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y, float z) {
+float SimplexNoise::noiseFloat(float x, float y, float z) {
     float n0, n1, n2, n3; // Noise contributions from the four corners
 
     // Skewing/Unskewing factors for 3D
@@ -396,6 +407,286 @@ float SimplexNoise::noise(float x, float y, float z) {
 }
 
 
+/**
+ * Fixed point kernels
+ *
+ * Same algorithm as the float ones above, with Q16.16 coordinates and result. Within a kernel,
+ * residuals (distances to the corners) are Q1.15 (Q2.14 in 1D, where they reach 1), so that
+ * squares and products of them still fit in 32 bits, and the Cortex-M0+ only needs its single
+ * cycle 32x32 multiplier. The only 64 bits operation is the skew of the input coordinates,
+ * which can be large.
+ *
+ * The hashes repeat every 256 cells, so only the skewed coordinates modulo 2^32 (2^16 cells) matter,
+ * and those are exact however large the Q48.16 input : the skew is taken from the whole sum of the
+ * coordinates, and its product may wrap around 64 bits, since only its bits 32 to 63 are kept.
+ */
+static const int32_t Q14_ONE = 1 << 14;
+static const int32_t Q15_ONE = 1 << 15;
+
+static inline int32_t gradFixed(int32_t hash, int32_t x) {
+    const int32_t h = hash & 0x0F;
+    const int32_t grad = 1 + (h & 7);
+    return (h & 8) ? -grad * x : grad * x;
+}
+
+static inline int32_t gradFixed(int32_t hash, int32_t x, int32_t y) {
+    const int32_t h = hash & 0x3F;
+    const int32_t u = h < 4 ? x : y;
+    const int32_t v = h < 4 ? y : x;
+    return ((h & 1) ? -u : u) + ((h & 2) ? -2 * v : 2 * v);
+}
+
+static inline int32_t gradFixed(int32_t hash, int32_t x, int32_t y, int32_t z) {
+    const int h = hash & 15;
+    const int32_t u = h < 8 ? x : y;
+    const int32_t v = h < 4 ? y : h == 12 || h == 14 ? x : z;
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+/**
+ * Contribution of a corner : t^4 * grad, in Q2.30
+ *
+ * @param[in] t     Q1.15 falloff (radius² minus the squared distance to the corner), nothing if negative
+ * @param[in] grad  Q15 gradient-dot-residual
+ */
+static inline int32_t cornerFixed(int32_t t, int32_t grad) {
+    if (t <= 0) {
+        return 0;
+    }
+    t = (t * t + (1 << 14)) >> 15;
+    t = (t * t + (1 << 14)) >> 15;
+    return t * grad;
+}
+
+/**
+ * Squared distance to a corner, in Q1.15 from Q1.15 residuals. Unsigned, as the sum of the
+ * squares of far corners, that are then discarded, can go past 2.
+ */
+static inline int32_t squaredFixed(int32_t x, int32_t y, int32_t z = 0) {
+    return ((uint32_t)(x * x) + (uint32_t)(y * y) + (uint32_t)(z * z) + (1 << 14)) >> 15;
+}
+
+/**
+ * 1D Perlin simplex noise, fixed point
+ *
+ * @param[in] x Q16.16 coordinate
+ *
+ * @return Q16.16 noise value in the range[-1; 1]
+ */
+q16_16 SimplexNoise::noiseFixed(q48_16 x) {
+    const int32_t i0 = floorQ16((q16_16)(uint32_t)x);
+    const int32_t x0 = fracQ16((q16_16)(uint32_t)x) >> 2;  // Distances to the corners
+    const int32_t x1 = x0 - Q14_ONE;
+
+    // The contributions stay in Q4.28 here, as the 1D gradients go up to 8
+    int32_t t0 = Q14_ONE - ((x0 * x0) >> 14);
+    t0 = (t0 * t0) >> 14;
+    const int32_t n0 = ((t0 * t0) >> 14) * gradFixed(hash(i0), x0);
+    int32_t t1 = Q14_ONE - ((x1 * x1) >> 14);
+    t1 = (t1 * t1) >> 14;
+    const int32_t n1 = ((t1 * t1) >> 14) * gradFixed(hash(i0 + 1), x1);
+
+    // 0.395 * (n0 + n1) : 1618 is 0.395 in Q12, and Q18 * Q12 >> 14 gives Q16
+    return ((n0 + n1) >> 10) * 1618 >> 14;
+}
+
+// Skewing/Unskewing factors, shared by the single sample and the grid kernels
+static const int64_t F2_Q32 = 1572067135;  // (sqrt(3) - 1) / 2 in Q32
+static const uint32_t G2_Q16 = 13849;      // (3 - sqrt(3)) / 6 in Q16
+static const int32_t G2_Q15 = 6925;
+static const int32_t G2x2_Q15 = 13850;
+static const int64_t F3_Q32 = 1431655765;  // 1/3 in Q32
+static const uint32_t G3_Q16 = 10923;      // 1/6 in Q16
+static const int32_t G3_Q15 = 5461;
+static const int32_t G3x2_Q15 = 10923;
+static const int32_t G3x3_Q15 = 16384;
+
+/**
+ * Contributions of the three corners of a 2D simplex
+ *
+ * @param[in] fx, fy    Q16 position within the skewed cell, between 0 and 1
+ * @param[in] h00, h10, h01, h11    Hashes of the corners of the skewed cell
+ *
+ * @return Q16.16 noise value
+ */
+static inline q16_16 simplex2dFixed(uint32_t fx, uint32_t fy, uint8_t h00, uint8_t h10, uint8_t h01, uint8_t h11) {
+    // Unskewing the position within the cell rather than the cell origin, to only deal with small numbers
+    const uint32_t t = ((fx + fy) * G2_Q16) >> 16;
+    const int32_t x0 = (int32_t)(fx - t) >> 1;
+    const int32_t y0 = (int32_t)(fy - t) >> 1;
+
+    const int32_t i1 = x0 > y0 ? 1 : 0;  // Lower or upper triangle
+    const int32_t j1 = 1 - i1;
+
+    const int32_t x1 = x0 - i1 * Q15_ONE + G2_Q15;
+    const int32_t y1 = y0 - j1 * Q15_ONE + G2_Q15;
+    const int32_t x2 = x0 - Q15_ONE + G2x2_Q15;
+    const int32_t y2 = y0 - Q15_ONE + G2x2_Q15;
+
+    const int32_t n0 = cornerFixed((Q15_ONE / 2) - squaredFixed(x0, y0), gradFixed(h00, x0, y0));
+    const int32_t n1 = cornerFixed((Q15_ONE / 2) - squaredFixed(x1, y1), gradFixed(i1 ? h10 : h01, x1, y1));
+    const int32_t n2 = cornerFixed((Q15_ONE / 2) - squaredFixed(x2, y2), gradFixed(h11, x2, y2));
+
+    // 45.23065 * (n0 + n1 + n2) : 46316 is 45.23065 in Q10, and Q20 * Q10 >> 14 gives Q16
+    return ((n0 + n1 + n2) >> 10) * 46316 >> 14;
+}
+
+/**
+ * 2D Perlin simplex noise, fixed point
+ *
+ * @param[in] x Q16.16 coordinate
+ * @param[in] y Q16.16 coordinate
+ *
+ * @return Q16.16 noise value in the range[-1; 1]
+ */
+q16_16 SimplexNoise::noiseFixed(q48_16 x, q48_16 y) {
+    // Skew the input space to determine which simplex cell we're in
+    const uint32_t s = (uint32_t)(((uint64_t)(x + y) * F2_Q32) >> 32);
+    const q16_16 xs = (q16_16)((uint32_t)x + s);
+    const q16_16 ys = (q16_16)((uint32_t)y + s);
+    const int32_t i = floorQ16(xs);
+    const int32_t j = floorQ16(ys);
+
+    return simplex2dFixed(fracQ16(xs), fracQ16(ys),
+        hash(i + hash(j)), hash(i + 1 + hash(j)), hash(i + hash(j + 1)), hash(i + 1 + hash(j + 1)));
+}
+
+/**
+ * Corner offsets of the 3D simplex containing a point, given its residuals to the cell origin
+ */
+static inline void simplexOrder3d(int32_t x0, int32_t y0, int32_t z0, int &i1, int &j1, int &k1, int &i2, int &j2, int &k2) {
+    if (x0 >= y0) {
+        if (y0 >= z0) {
+            i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0; // X Y Z order
+        } else if (x0 >= z0) {
+            i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1; // X Z Y order
+        } else {
+            i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1; // Z X Y order
+        }
+    } else { // x0<y0
+        if (y0 < z0) {
+            i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1; // Z Y X order
+        } else if (x0 < z0) {
+            i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1; // Y Z X order
+        } else {
+            i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0; // Y X Z order
+        }
+    }
+}
+
+/**
+ * Contributions of the four corners of a 3D simplex
+ *
+ * @param[in] x0, y0, z0    Q1.15 residuals to the cell origin
+ * @param[in] i1 .. k2      Offsets of the second and third corners, see simplexOrder3d()
+ * @param[in] gi0 .. gi3    Hashes of the four corners
+ *
+ * @return Q16.16 noise value
+ */
+static inline q16_16 simplex3dFixed(int32_t x0, int32_t y0, int32_t z0, int i1, int j1, int k1, int i2, int j2, int k2,
+                                    int gi0, int gi1, int gi2, int gi3) {
+    const int32_t x1 = x0 - i1 * Q15_ONE + G3_Q15;
+    const int32_t y1 = y0 - j1 * Q15_ONE + G3_Q15;
+    const int32_t z1 = z0 - k1 * Q15_ONE + G3_Q15;
+    const int32_t x2 = x0 - i2 * Q15_ONE + G3x2_Q15;
+    const int32_t y2 = y0 - j2 * Q15_ONE + G3x2_Q15;
+    const int32_t z2 = z0 - k2 * Q15_ONE + G3x2_Q15;
+    const int32_t x3 = x0 - Q15_ONE + G3x3_Q15;
+    const int32_t y3 = y0 - Q15_ONE + G3x3_Q15;
+    const int32_t z3 = z0 - Q15_ONE + G3x3_Q15;
+
+    static const int32_t R2 = 19661;  // 0.6 in Q15
+    const int32_t n0 = cornerFixed(R2 - squaredFixed(x0, y0, z0), gradFixed(gi0, x0, y0, z0));
+    const int32_t n1 = cornerFixed(R2 - squaredFixed(x1, y1, z1), gradFixed(gi1, x1, y1, z1));
+    const int32_t n2 = cornerFixed(R2 - squaredFixed(x2, y2, z2), gradFixed(gi2, x2, y2, z2));
+    const int32_t n3 = cornerFixed(R2 - squaredFixed(x3, y3, z3), gradFixed(gi3, x3, y3, z3));
+
+    // 32 * (n0 + n1 + n2 + n3), from Q30 to Q16
+    return (n0 + n1 + n2 + n3) >> 9;
+}
+
+/**
+ * Residuals to the 3D cell origin, in Q1.15, from the Q16 position within the skewed cell
+ */
+static inline void unskew3dFixed(uint32_t fx, uint32_t fy, uint32_t fz, int32_t &x0, int32_t &y0, int32_t &z0) {
+    const uint32_t t = ((fx + fy + fz) * G3_Q16) >> 16;  // Fits, as unsigned
+    x0 = (int32_t)(fx - t) >> 1;
+    y0 = (int32_t)(fy - t) >> 1;
+    z0 = (int32_t)(fz - t) >> 1;
+}
+
+/**
+ * 3D Perlin simplex noise, fixed point
+ *
+ * @param[in] x Q16.16 coordinate
+ * @param[in] y Q16.16 coordinate
+ * @param[in] z Q16.16 coordinate
+ *
+ * @return Q16.16 noise value in the range[-1; 1]
+ */
+q16_16 SimplexNoise::noiseFixed(q48_16 x, q48_16 y, q48_16 z) {
+    const uint32_t s = (uint32_t)(((uint64_t)(x + y + z) * F3_Q32) >> 32);
+    const q16_16 xs = (q16_16)((uint32_t)x + s);
+    const q16_16 ys = (q16_16)((uint32_t)y + s);
+    const q16_16 zs = (q16_16)((uint32_t)z + s);
+    const int32_t i = floorQ16(xs);
+    const int32_t j = floorQ16(ys);
+    const int32_t k = floorQ16(zs);
+
+    int32_t x0, y0, z0;
+    unskew3dFixed(fracQ16(xs), fracQ16(ys), fracQ16(zs), x0, y0, z0);
+
+    int i1, j1, k1; // Offsets for second corner of simplex in (i,j,k) coords
+    int i2, j2, k2; // Offsets for third corner of simplex in (i,j,k) coords
+    simplexOrder3d(x0, y0, z0, i1, j1, k1, i2, j2, k2);
+
+    return simplex3dFixed(x0, y0, z0, i1, j1, k1, i2, j2, k2,
+        hash(i + hash(j + hash(k))),
+        hash(i + i1 + hash(j + j1 + hash(k + k1))),
+        hash(i + i2 + hash(j + j2 + hash(k + k2))),
+        hash(i + 1 + hash(j + 1 + hash(k + 1))));
+}
+/**
+ * Float coordinate as Q48.16, clamped to +-NOISE_COORDINATE_LIMIT so that the octaves can't overflow
+ */
+static inline q48_16 toCoordinate(float value) {
+    if (!(value > -NOISE_COORDINATE_LIMIT && value < NOISE_COORDINATE_LIMIT)) {  // NaN included
+#if GRID_BOUNDS_CHECK
+        noise_range_handler(value);
+#endif
+        value = value > 0 ? NOISE_COORDINATE_LIMIT : -NOISE_COORDINATE_LIMIT;
+    }
+    return toQ48(value);
+}
+
+/**
+ * Dispatch of the float entry points, see SIMPLEX_NOISE_FIXED_POINT
+ */
+float SimplexNoise::noise(float x) {
+#if SIMPLEX_NOISE_FIXED_POINT
+    return fromQ16(noiseFixed(toCoordinate(x)));
+#else
+    return noiseFloat(x);
+#endif
+}
+
+float SimplexNoise::noise(float x, float y) {
+#if SIMPLEX_NOISE_FIXED_POINT
+    return fromQ16(noiseFixed(toCoordinate(x), toCoordinate(y)));
+#else
+    return noiseFloat(x, y);
+#endif
+}
+
+float SimplexNoise::noise(float x, float y, float z) {
+#if SIMPLEX_NOISE_FIXED_POINT
+    return fromQ16(noiseFixed(toCoordinate(x), toCoordinate(y), toCoordinate(z)));
+#else
+    return noiseFloat(x, y, z);
+#endif
+}
+
+
 /**
  * Fractal/Fractional Brownian Motion (fBm) summation of 1D Perlin Simplex noise
  *
@@ -475,6 +766,9 @@ float SimplexNoise::fractal(size_t octaves, float x, float y, float z) const {
 }
 
 float SimplexNoise::noise2dOctaves(float x, float y, int octaves, float persistence) {
+#if SIMPLEX_NOISE_FIXED_POINT
+  return fromQ16(SimplexNoise::noise2dOctavesFixed(toCoordinate(x), toCoordinate(y), octaves, toQ16(persistence)));
+#endif
   float max_amp = 0.0f;
   float amp = 1.0f;
   float noise = 0.0f;
@@ -489,6 +783,9 @@ float SimplexNoise::noise2dOctaves(float x, float y, int octaves, float persiste
 }
 
 float SimplexNoise::noise3dOctaves(float x, float y, float z, int octaves, float persistence) {
+#if SIMPLEX_NOISE_FIXED_POINT
+  return fromQ16(SimplexNoise::noise3dOctavesFixed(toCoordinate(x), toCoordinate(y), toCoordinate(z), octaves, toQ16(persistence)));
+#endif
   float max_amp = 0.0f;
   float amp = 1.0f;
   float noise = 0.0f;
@@ -501,3 +798,457 @@ float SimplexNoise::noise3dOctaves(float x, float y, float z, int octaves, float
   }
   return (noise / max_amp);
 }
+
+// The sum is normalized with a 64 bits division, so that any sum of the amplitudes fits, as with the
+// float helpers. Coordinates are scaled by a multiplication, as negative ones can't be shifted left.
+q16_16 SimplexNoise::noise2dOctavesFixed(q48_16 x, q48_16 y, int octaves, q16_16 persistence) {
+  q16_16 max_amp = 0;
+  q16_16 amp = Q16_ONE;
+  q16_16 noise = 0;
+  for (int i = 0; i < octaves; i++) {
+    const q48_16 freq = (q48_16)1 << i;
+    noise += mulQ16(SimplexNoise::noiseFixed(x * freq, y * freq), amp);
+    max_amp += amp;
+    amp = mulQ16(amp, persistence);
+  }
+  return (q16_16)((int64_t)noise * Q16_ONE / max_amp);
+}
+
+q16_16 SimplexNoise::noise3dOctavesFixed(q48_16 x, q48_16 y, q48_16 z, int octaves, q16_16 persistence) {
+  q16_16 max_amp = 0;
+  q16_16 amp = Q16_ONE;
+  q16_16 noise = 0;
+  for (int i = 0; i < octaves; i++) {
+    const q48_16 freq = (q48_16)1 << i;
+    noise += mulQ16(SimplexNoise::noiseFixed(x * freq, y * freq, z * freq), amp);
+    max_amp += amp;
+    amp = mulQ16(amp, persistence);
+  }
+  return (q16_16)((int64_t)noise * Q16_ONE / max_amp);
+}
+
+/**
+ * Grid evaluation
+ *
+ * Samples of a row are a constant step apart, so the skew is stepped incrementally (exactly, in
+ * fixed point), and the hashes of a simplex cell are only looked up when a sample enters a new
+ * cell, then shared by the following ones. The float rows are done by chunks in two passes : a
+ * scalar one that finds the cells, residuals and gradient vectors, then a branchless one over
+ * those arrays that the compiler can vectorize.
+ */
+static const int GRID_CHUNK = 16;
+
+// Gradients of grad(hash, x, y) and grad(hash, x, y, z) as vectors, indexed by the hash
+struct GradientTables {
+    int8_t x2[64], y2[64];
+    int8_t x3[16], y3[16], z3[16];
+};
+
+static constexpr GradientTables GRADIENTS = [] {
+    GradientTables g = {};
+    for (int h = 0; h < 64; h++) {
+        const int8_t s1 = (h & 1) ? -1 : 1;
+        const int8_t s2 = (h & 2) ? -2 : 2;
+        g.x2[h] = h < 4 ? s1 : s2;
+        g.y2[h] = h < 4 ? s2 : s1;
+    }
+    for (int h = 0; h < 16; h++) {
+        int8_t *u = h < 8 ? &g.x3[h] : &g.y3[h];
+        int8_t *v = h < 4 ? &g.y3[h] : h == 12 || h == 14 ? &g.x3[h] : &g.z3[h];
+        *u += (h & 1) ? -1 : 1;
+        *v += (h & 2) ? -1 : 1;
+    }
+    return g;
+}();
+
+/**
+ * Hashes of the 4 corners of a 2D cell, or of the 8 corners of a 3D one, that only get
+ * recomputed when the cell changes
+ */
+struct CellHashes {
+    bool valid = false;
+    int32_t i, j, k;
+    uint8_t h[8];  // Indexed by (di << 2) | (dj << 1) | dk
+
+    inline void update2d(int32_t i, int32_t j) {
+        if (this->valid && i == this->i && j == this->j) {
+            return;
+        }
+        this->i = i; this->j = j; this->valid = true;
+        const uint8_t hj0 = hash(j);
+        const uint8_t hj1 = hash(j + 1);
+        this->h[0] = hash(i + hj0);
+        this->h[4] = hash(i + 1 + hj0);
+        this->h[2] = hash(i + hj1);
+        this->h[6] = hash(i + 1 + hj1);
+    }
+
+    inline void update3d(int32_t i, int32_t j, int32_t k) {
+        if (this->valid && i == this->i && j == this->j && k == this->k) {
+            return;
+        }
+        this->i = i; this->j = j; this->k = k; this->valid = true;
+        for (int c = 0; c < 8; c++) {
+            this->h[c] = hash(i + (c >> 2) + hash(j + ((c >> 1) & 1) + hash(k + (c & 1))));
+        }
+    }
+};
+
+// The coordinates are stepped modulo 2^32 like the skew is modulo 2^64, see the fixed point kernels
+static void noiseRow2dFixed(q16_16 *out, uint16_t n, q48_16 x_start, q48_16 y_start, q48_16 dx) {
+    uint64_t skew = (uint64_t)(x_start + y_start) * F2_Q32;  // (x + y) * F2, stepped by dx * F2 which is exact in Q48
+    const uint64_t skew_step = (uint64_t)dx * F2_Q32;
+    uint32_t x = x_start;
+    const uint32_t y = y_start;
+    CellHashes cell;
+    for (int k = 0; k < n; k++, x += (uint32_t)dx, skew += skew_step) {
+        const uint32_t s = (uint32_t)(skew >> 32);
+        const q16_16 xs = (q16_16)(x + s);
+        const q16_16 ys = (q16_16)(y + s);
+        cell.update2d(floorQ16(xs), floorQ16(ys));
+        out[k] = simplex2dFixed(fracQ16(xs), fracQ16(ys), cell.h[0], cell.h[4], cell.h[2], cell.h[6]);
+    }
+}
+
+static void noiseRow3dFixed(q16_16 *out, uint16_t n, q48_16 x_start, q48_16 y_start, q48_16 z_start, q48_16 dx) {
+    uint64_t skew = (uint64_t)(x_start + y_start + z_start) * F3_Q32;
+    const uint64_t skew_step = (uint64_t)dx * F3_Q32;
+    uint32_t x = x_start;
+    const uint32_t y = y_start;
+    const uint32_t z = z_start;
+    CellHashes cell;
+    int32_t x0, y0, z0;
+    int i1, j1, k1, i2, j2, k2;
+    for (int k = 0; k < n; k++, x += (uint32_t)dx, skew += skew_step) {
+        const uint32_t s = (uint32_t)(skew >> 32);
+        const q16_16 xs = (q16_16)(x + s);
+        const q16_16 ys = (q16_16)(y + s);
+        const q16_16 zs = (q16_16)(z + s);
+        cell.update3d(floorQ16(xs), floorQ16(ys), floorQ16(zs));
+        unskew3dFixed(fracQ16(xs), fracQ16(ys), fracQ16(zs), x0, y0, z0);
+        simplexOrder3d(x0, y0, z0, i1, j1, k1, i2, j2, k2);
+        out[k] = simplex3dFixed(x0, y0, z0, i1, j1, k1, i2, j2, k2,
+            cell.h[0], cell.h[(i1 << 2) | (j1 << 1) | k1], cell.h[(i2 << 2) | (j2 << 1) | k2], cell.h[7]);
+    }
+}
+
+static void noiseChunk2dFloat(float *out, int n, float x, float y, float dx) {
+    static const float F2 = 0.366025403f;
+    static const float G2 = 0.211324865f;
+    float rx[3][GRID_CHUNK], ry[3][GRID_CHUNK];  // Residuals to the three corners
+    float gx[3][GRID_CHUNK], gy[3][GRID_CHUNK];  // Gradients of the three corners
+    CellHashes cell;
+
+    for (int k = 0; k < n; k++) {
+        const float px = x + k * dx;
+        const float s = (px + y) * F2;
+        const int32_t i = fastfloor(px + s);
+        const int32_t j = fastfloor(y + s);
+        cell.update2d(i, j);
+        const float t = static_cast<float>(i + j) * G2;
+        const float x0 = px - (i - t);
+        const float y0 = y - (j - t);
+        const int i1 = x0 > y0 ? 1 : 0;
+        const uint8_t h[3] = {cell.h[0], i1 ? cell.h[4] : cell.h[2], cell.h[6]};
+
+        rx[0][k] = x0;
+        ry[0][k] = y0;
+        rx[1][k] = x0 - i1 + G2;
+        ry[1][k] = y0 - (1 - i1) + G2;
+        rx[2][k] = x0 - 1.0f + 2.0f * G2;
+        ry[2][k] = y0 - 1.0f + 2.0f * G2;
+        for (int c = 0; c < 3; c++) {
+            gx[c][k] = GRADIENTS.x2[h[c] & 0x3F];
+            gy[c][k] = GRADIENTS.y2[h[c] & 0x3F];
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        float sum = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            float t = 0.5f - rx[c][k] * rx[c][k] - ry[c][k] * ry[c][k];
+            t = t > 0.0f ? t : 0.0f;
+            t *= t;
+            sum += t * t * (gx[c][k] * rx[c][k] + gy[c][k] * ry[c][k]);
+        }
+        out[k] = 45.23065f * sum;
+    }
+}
+
+static void noiseChunk3dFloat(float *out, int n, float x, float y, float z, float dx) {
+    static const float F3 = 1.0f / 3.0f;
+    static const float G3 = 1.0f / 6.0f;
+    float rx[4][GRID_CHUNK], ry[4][GRID_CHUNK], rz[4][GRID_CHUNK];
+    float gx[4][GRID_CHUNK], gy[4][GRID_CHUNK], gz[4][GRID_CHUNK];
+    CellHashes cell;
+    int i1, j1, k1, i2, j2, k2;
+
+    for (int k = 0; k < n; k++) {
+        const float px = x + k * dx;
+        const float s = (px + y + z) * F3;
+        const int32_t i = fastfloor(px + s);
+        const int32_t j = fastfloor(y + s);
+        const int32_t l = fastfloor(z + s);
+        cell.update3d(i, j, l);
+        const float t = (i + j + l) * G3;
+        const float x0 = px - (i - t);
+        const float y0 = y - (j - t);
+        const float z0 = z - (l - t);
+        // The ordering only compares the residuals, any type does
+        if (x0 >= y0) {
+            if (y0 >= z0) {
+                i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0;
+            } else if (x0 >= z0) {
+                i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1;
+            } else {
+                i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1;
+            }
+        } else {
+            if (y0 < z0) {
+                i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1;
+            } else if (x0 < z0) {
+                i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1;
+            } else {
+                i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0;
+            }
+        }
+        const uint8_t h[4] = {cell.h[0], cell.h[(i1 << 2) | (j1 << 1) | k1], cell.h[(i2 << 2) | (j2 << 1) | k2], cell.h[7]};
+
+        rx[0][k] = x0;
+        ry[0][k] = y0;
+        rz[0][k] = z0;
+        rx[1][k] = x0 - i1 + G3;
+        ry[1][k] = y0 - j1 + G3;
+        rz[1][k] = z0 - k1 + G3;
+        rx[2][k] = x0 - i2 + 2.0f * G3;
+        ry[2][k] = y0 - j2 + 2.0f * G3;
+        rz[2][k] = z0 - k2 + 2.0f * G3;
+        rx[3][k] = x0 - 1.0f + 3.0f * G3;
+        ry[3][k] = y0 - 1.0f + 3.0f * G3;
+        rz[3][k] = z0 - 1.0f + 3.0f * G3;
+        for (int c = 0; c < 4; c++) {
+            gx[c][k] = GRADIENTS.x3[h[c] & 15];
+            gy[c][k] = GRADIENTS.y3[h[c] & 15];
+            gz[c][k] = GRADIENTS.z3[h[c] & 15];
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        float sum = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            float t = 0.6f - rx[c][k] * rx[c][k] - ry[c][k] * ry[c][k] - rz[c][k] * rz[c][k];
+            t = t > 0.0f ? t : 0.0f;
+            t *= t;
+            sum += t * t * (gx[c][k] * rx[c][k] + gy[c][k] * ry[c][k] + gz[c][k] * rz[c][k]);
+        }
+        out[k] = 32.0f * sum;
+    }
+}
+
+/**
+ * One row of samples, through the kernels selected by SIMPLEX_NOISE_FIXED_POINT
+ */
+static void noiseRow2d(float *out, uint16_t n, float x, float y, float dx) {
+#if SIMPLEX_NOISE_FIXED_POINT
+    q16_16 fixed[GRID_CHUNK];
+    const q16_16 fixed_dx = toQ16(dx);
+    for (int k = 0; k < n; k += GRID_CHUNK) {
+        const int count = n - k < GRID_CHUNK ? n - k : GRID_CHUNK;
+        noiseRow2dFixed(fixed, count, toCoordinate(x) + k * fixed_dx, toCoordinate(y), fixed_dx);
+        for (int c = 0; c < count; c++) {
+            out[k + c] = fromQ16(fixed[c]);
+        }
+    }
+#else
+    for (int k = 0; k < n; k += GRID_CHUNK) {
+        noiseChunk2dFloat(out + k, n - k < GRID_CHUNK ? n - k : GRID_CHUNK, x + k * dx, y, dx);
+    }
+#endif
+}
+
+static void noiseRow3d(float *out, uint16_t n, float x, float y, float z, float dx) {
+#if SIMPLEX_NOISE_FIXED_POINT
+    q16_16 fixed[GRID_CHUNK];
+    const q16_16 fixed_dx = toQ16(dx);
+    for (int k = 0; k < n; k += GRID_CHUNK) {
+        const int count = n - k < GRID_CHUNK ? n - k : GRID_CHUNK;
+        noiseRow3dFixed(fixed, count, toCoordinate(x) + k * fixed_dx, toCoordinate(y), toCoordinate(z), fixed_dx);
+        for (int c = 0; c < count; c++) {
+            out[k + c] = fromQ16(fixed[c]);
+        }
+    }
+#else
+    for (int k = 0; k < n; k += GRID_CHUNK) {
+        noiseChunk3dFloat(out + k, n - k < GRID_CHUNK ? n - k : GRID_CHUNK, x + k * dx, y, z, dx);
+    }
+#endif
+}
+
+void SimplexNoise::fill2d(float *out, uint16_t w, uint16_t h, float x0, float y0, float dx, float dy) {
+    PROFILE_SCOPE(NOISE);
+    for (int row = 0; row < h; row++) {
+        noiseRow2d(out + row * w, w, x0, y0 + row * dy, dx);
+    }
+}
+
+void SimplexNoise::fill3d(float *out, uint16_t w, uint16_t h, float x0, float y0, float z, float dx, float dy) {
+    PROFILE_SCOPE(NOISE);
+    for (int row = 0; row < h; row++) {
+        noiseRow3d(out + row * w, w, x0, y0 + row * dy, z, dx);
+    }
+}
+
+void SimplexNoise::fill2dOctaves(float *out, uint16_t w, uint16_t h, float x0, float y0, float dx, float dy, int octaves, float persistence) {
+    PROFILE_SCOPE(NOISE);
+#if SIMPLEX_NOISE_FIXED_POINT
+    q16_16 fixed[GRID_CHUNK];
+    for (int row = 0; row < h; row++) {
+        for (int k = 0; k < w; k += GRID_CHUNK) {
+            const int count = w - k < GRID_CHUNK ? w - k : GRID_CHUNK;
+            SimplexNoise::fill2dOctavesFixed(fixed, count, 1, toCoordinate(x0 + k * dx), toCoordinate(y0 + row * dy), toQ16(dx), 0, octaves, toQ16(persistence));
+            for (int c = 0; c < count; c++) {
+                out[row * w + k + c] = fromQ16(fixed[c]);
+            }
+        }
+    }
+#else
+    float octave[GRID_CHUNK];
+    for (int row = 0; row < h; row++) {
+        for (int k = 0; k < w; k += GRID_CHUNK) {
+            const int count = w - k < GRID_CHUNK ? w - k : GRID_CHUNK;
+            float *sum = out + row * w + k;
+            float max_amp = 0.0f;
+            float amp = 1.0f;
+            float freq = 1.0f;
+            for (int c = 0; c < count; c++) {
+                sum[c] = 0.0f;
+            }
+            for (int i = 0; i < octaves; i++) {
+                noiseRow2d(octave, count, (x0 + k * dx) * freq, (y0 + row * dy) * freq, dx * freq);
+                for (int c = 0; c < count; c++) {
+                    sum[c] += octave[c] * amp;
+                }
+                max_amp += amp;
+                amp *= persistence;
+                freq *= 2;
+            }
+            for (int c = 0; c < count; c++) {
+                sum[c] /= max_amp;
+            }
+        }
+    }
+#endif
+}
+
+void SimplexNoise::fill3dOctaves(float *out, uint16_t w, uint16_t h, float x0, float y0, float z, float dx, float dy, int octaves, float persistence) {
+    PROFILE_SCOPE(NOISE);
+#if SIMPLEX_NOISE_FIXED_POINT
+    q16_16 fixed[GRID_CHUNK];
+    for (int row = 0; row < h; row++) {
+        for (int k = 0; k < w; k += GRID_CHUNK) {
+            const int count = w - k < GRID_CHUNK ? w - k : GRID_CHUNK;
+            SimplexNoise::fill3dOctavesFixed(fixed, count, 1, toCoordinate(x0 + k * dx), toCoordinate(y0 + row * dy), toCoordinate(z), toQ16(dx), 0, octaves, toQ16(persistence));
+            for (int c = 0; c < count; c++) {
+                out[row * w + k + c] = fromQ16(fixed[c]);
+            }
+        }
+    }
+#else
+    float octave[GRID_CHUNK];
+    for (int row = 0; row < h; row++) {
+        for (int k = 0; k < w; k += GRID_CHUNK) {
+            const int count = w - k < GRID_CHUNK ? w - k : GRID_CHUNK;
+            float *sum = out + row * w + k;
+            float max_amp = 0.0f;
+            float amp = 1.0f;
+            float freq = 1.0f;
+            for (int c = 0; c < count; c++) {
+                sum[c] = 0.0f;
+            }
+            for (int i = 0; i < octaves; i++) {
+                noiseRow3d(octave, count, (x0 + k * dx) * freq, (y0 + row * dy) * freq, z * freq, dx * freq);
+                for (int c = 0; c < count; c++) {
+                    sum[c] += octave[c] * amp;
+                }
+                max_amp += amp;
+                amp *= persistence;
+                freq *= 2;
+            }
+            for (int c = 0; c < count; c++) {
+                sum[c] /= max_amp;
+            }
+        }
+    }
+#endif
+}
+
+void SimplexNoise::fill2dFixed(q16_16 *out, uint16_t w, uint16_t h, q48_16 x0, q48_16 y0, q16_16 dx, q16_16 dy) {
+    PROFILE_SCOPE(NOISE);
+    for (int row = 0; row < h; row++) {
+        noiseRow2dFixed(out + row * w, w, x0, y0 + row * dy, dx);
+    }
+}
+
+void SimplexNoise::fill3dFixed(q16_16 *out, uint16_t w, uint16_t h, q48_16 x0, q48_16 y0, q48_16 z, q16_16 dx, q16_16 dy) {
+    PROFILE_SCOPE(NOISE);
+    for (int row = 0; row < h; row++) {
+        noiseRow3dFixed(out + row * w, w, x0, y0 + row * dy, z, dx);
+    }
+}
+
+// Same sums as noise2dOctavesFixed()/noise3dOctavesFixed(), so the results are identical
+void SimplexNoise::fill2dOctavesFixed(q16_16 *out, uint16_t w, uint16_t h, q48_16 x0, q48_16 y0, q16_16 dx, q16_16 dy, int octaves, q16_16 persistence) {
+    PROFILE_SCOPE(NOISE);
+    q16_16 octave[GRID_CHUNK];
+    for (int row = 0; row < h; row++) {
+        for (int k = 0; k < w; k += GRID_CHUNK) {
+            const int count = w - k < GRID_CHUNK ? w - k : GRID_CHUNK;
+            q16_16 *sum = out + row * w + k;
+            q16_16 max_amp = 0;
+            q16_16 amp = Q16_ONE;
+            for (int c = 0; c < count; c++) {
+                sum[c] = 0;
+            }
+            for (int i = 0; i < octaves; i++) {
+                const q48_16 freq = (q48_16)1 << i;
+                noiseRow2dFixed(octave, count, (x0 + k * dx) * freq, (y0 + row * dy) * freq, dx * freq);
+                for (int c = 0; c < count; c++) {
+                    sum[c] += mulQ16(octave[c], amp);
+                }
+                max_amp += amp;
+                amp = mulQ16(amp, persistence);
+            }
+            for (int c = 0; c < count; c++) {
+                sum[c] = (q16_16)((int64_t)sum[c] * Q16_ONE / max_amp);
+            }
+        }
+    }
+}
+
+void SimplexNoise::fill3dOctavesFixed(q16_16 *out, uint16_t w, uint16_t h, q48_16 x0, q48_16 y0, q48_16 z, q16_16 dx, q16_16 dy, int octaves, q16_16 persistence) {
+    PROFILE_SCOPE(NOISE);
+    q16_16 octave[GRID_CHUNK];
+    for (int row = 0; row < h; row++) {
+        for (int k = 0; k < w; k += GRID_CHUNK) {
+            const int count = w - k < GRID_CHUNK ? w - k : GRID_CHUNK;
+            q16_16 *sum = out + row * w + k;
+            q16_16 max_amp = 0;
+            q16_16 amp = Q16_ONE;
+            for (int c = 0; c < count; c++) {
+                sum[c] = 0;
+            }
+            for (int i = 0; i < octaves; i++) {
+                const q48_16 freq = (q48_16)1 << i;
+                noiseRow3dFixed(octave, count, (x0 + k * dx) * freq, (y0 + row * dy) * freq, z * freq, dx * freq);
+                for (int c = 0; c < count; c++) {
+                    sum[c] += mulQ16(octave[c], amp);
+                }
+                max_amp += amp;
+                amp = mulQ16(amp, persistence);
+            }
+            for (int c = 0; c < count; c++) {
+                sum[c] = (q16_16)((int64_t)sum[c] * Q16_ONE / max_amp);
+            }
+        }
+    }
+}
@@ -13,6 +13,26 @@
 #pragma once
 
 #include <cstddef>  // size_t
+#include <stdint.h>
+#include "fixed_point.h"
+#include "grid.h"  // GRID_BOUNDS_CHECK
+
+// Whether the float entry points run on the Q16.16 fixed point kernels. The RP2040 has no FPU,
+// so that's the default there, and the float kernels stay available as the reference.
+#ifndef SIMPLEX_NOISE_FIXED_POINT
+#ifdef ARDUINO_ARCH_RP2040
+#define SIMPLEX_NOISE_FIXED_POINT 1
+#else
+#define SIMPLEX_NOISE_FIXED_POINT 0
+#endif
+#endif
+
+static constexpr float NOISE_COORDINATE_LIMIT = 1 << 30;
+
+#if GRID_BOUNDS_CHECK
+typedef void (*NoiseRangeHandler)(float coordinate);
+extern NoiseRangeHandler noise_range_handler;  // Prints the coordinate on Serial, unless replaced
+#endif
 
 /**
  * @brief A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D, 4D).
@@ -29,6 +49,35 @@ public:
     static float noise2dOctaves(float x, float y, int octaves, float persistence);
     static float noise3dOctaves(float x, float y, float z, int octaves, float persistence);
 
+    // Float reference kernels, whatever SIMPLEX_NOISE_FIXED_POINT is
+    static float noiseFloat(float x);
+    static float noiseFloat(float x, float y);
+    static float noiseFloat(float x, float y, float z);
+
+    // Same noise with a Q16.16 result, in integer arithmetic only. Coordinates are Q48.16, so that
+    // they can take an animation time that runs for days, doubled at every octave : the kernels are
+    // exact for any of them, as only the skewed coordinates modulo 256 cells matter. The float entry
+    // points clamp theirs to +-NOISE_COORDINATE_LIMIT (reported with GRID_BOUNDS_CHECK), past which a
+    // float has no fraction left anyway.
+    static q16_16 noiseFixed(q48_16 x);
+    static q16_16 noiseFixed(q48_16 x, q48_16 y);
+    static q16_16 noiseFixed(q48_16 x, q48_16 y, q48_16 z);
+    static q16_16 noise2dOctavesFixed(q48_16 x, q48_16 y, int octaves, q16_16 persistence);
+    static q16_16 noise3dOctavesFixed(q48_16 x, q48_16 y, q48_16 z, int octaves, q16_16 persistence);
+
+    // Grid evaluation : out[row * w + col] = noise(x0 + col * dx, y0 + row * dy), at a constant z
+    // for 3D. Neighbouring samples share the hashing of their simplex cell, the float kernels are
+    // vectorized on the host, and the fixed point ones give exactly the same values as noiseFixed().
+    // The float grids follow SIMPLEX_NOISE_FIXED_POINT like noise() does.
+    static void fill2d(float *out, uint16_t w, uint16_t h, float x0, float y0, float dx, float dy);
+    static void fill3d(float *out, uint16_t w, uint16_t h, float x0, float y0, float z, float dx, float dy);
+    static void fill2dOctaves(float *out, uint16_t w, uint16_t h, float x0, float y0, float dx, float dy, int octaves, float persistence);
+    static void fill3dOctaves(float *out, uint16_t w, uint16_t h, float x0, float y0, float z, float dx, float dy, int octaves, float persistence);
+    static void fill2dFixed(q16_16 *out, uint16_t w, uint16_t h, q48_16 x0, q48_16 y0, q16_16 dx, q16_16 dy);
+    static void fill3dFixed(q16_16 *out, uint16_t w, uint16_t h, q48_16 x0, q48_16 y0, q48_16 z, q16_16 dx, q16_16 dy);
+    static void fill2dOctavesFixed(q16_16 *out, uint16_t w, uint16_t h, q48_16 x0, q48_16 y0, q16_16 dx, q16_16 dy, int octaves, q16_16 persistence);
+    static void fill3dOctavesFixed(q16_16 *out, uint16_t w, uint16_t h, q48_16 x0, q48_16 y0, q48_16 z, q16_16 dx, q16_16 dy, int octaves, q16_16 persistence);
+
     // Fractal/Fractional Brownian Motion (fBm) noise summation
     float fractal(size_t octaves, float x) const;
     float fractal(size_t octaves, float x, float y) const;
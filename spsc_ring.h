@@ -0,0 +1,46 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-size lock-free queue between exactly one producer and one consumer, which can run on the two
+// cores of the RP2040 (or be an interrupt handler and the main loop). head and tail are free-running
+// counters, each only ever written by one side, so no compare-and-swap is needed, which the Cortex-M0+
+// doesn't have anyway : plain 32 bits loads and stores with acquire/release barriers are enough.
+template <typename T, uint32_t N>
+class SpscRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of 2");
+
+  private:
+    T items[N];
+    std::atomic<uint32_t> head{0};  // Count of pushed items, written by the producer only
+    std::atomic<uint32_t> tail{0};  // Count of popped items, written by the consumer only
+
+  public:
+    // Producer side. Returns false, and drops the item, if the queue is full.
+    bool push(const T &item) {
+      const uint32_t h = this->head.load(std::memory_order_relaxed);
+      if (h - this->tail.load(std::memory_order_acquire) == N)
+        return false;
+      this->items[h & (N - 1)] = item;
+      this->head.store(h + 1, std::memory_order_release);  // Publishes the item written above
+      return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty.
+    bool pop(T &item) {
+      const uint32_t t = this->tail.load(std::memory_order_relaxed);
+      if (this->head.load(std::memory_order_acquire) == t)
+        return false;
+      item = this->items[t & (N - 1)];
+      this->tail.store(t + 1, std::memory_order_release);  // Hands the slot back to the producer
+      return true;
+    }
+
+    // Either side, only a snapshot since the other side keeps going
+    uint32_t size() const {return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire);}
+    bool empty() const {return this->size() == 0;}
+    static constexpr uint32_t capacity() {return N;}
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "telemetry.h"
+#include <string.h>
+#include "frame_profiler.h"
+
+void Telemetry::frameSent(uint32_t now_us, const FrameStats &stats) {
+  this->stats = stats;
+  if (stats.render_us > this->max_render_us)
+    this->max_render_us = stats.render_us;
+  if (now_us - this->last_stats_us >= this->stats_interval_us) {
+    this->last_stats_us = now_us;
+    this->stats_due = true;
+  }
+  if (this->profile_interval_us && now_us - this->last_profile_us >= this->profile_interval_us) {
+    this->last_profile_us = now_us;
+    this->profile_stage = 0;
+  }
+}
+
+void Telemetry::requestProfile() {
+  this->profile_stage = 0;
+}
+
+void Telemetry::requestSnapshot() {
+  uint8_t idle = IDLE;
+  this->snapshot_state.compare_exchange_strong(idle, REQUESTED, std::memory_order_release, std::memory_order_relaxed);  // Unless one is already on its way
+}
+
+void Telemetry::captureSnapshot(const Canvas &canvas) {
+  // Downsampled by the smallest factor that fits, averaging the pixels of each block
+  uint8_t factor = 1;
+  while (((canvas.width() + factor - 1) / factor) * ((canvas.height() + factor - 1) / factor) * 3 > SNAPSHOT_BYTES)
+    factor++;
+  const uint16_t width = (canvas.width() + factor - 1) / factor, height = (canvas.height() + factor - 1) / factor;
+  uint8_t *pixel = this->snapshot;
+  for (uint16_t y = 0; y < height; y++) {
+    for (uint16_t x = 0; x < width; x++) {
+      uint32_t r = 0, g = 0, b = 0, count = 0;
+      for (uint16_t sy = y * factor; sy < (y + 1) * factor && sy < canvas.height(); sy++) {
+        for (uint16_t sx = x * factor; sx < (x + 1) * factor && sx < canvas.width(); sx++) {
+          const uint32_t color = canvas.getPixel(sx, sy);
+          r += (color >> 16) & 0xff;
+          g += (color >> 8) & 0xff;
+          b += color & 0xff;
+          count++;
+        }
+      }
+      *pixel++ = r / count;
+      *pixel++ = g / count;
+      *pixel++ = b / count;
+    }
+  }
+  this->snapshot_width = width;
+  this->snapshot_height = height;
+  this->snapshot_factor = factor;
+  this->snapshot_state.store(CAPTURED, std::memory_order_release);
+}
+
+bool Telemetry::nextRecord(const uint8_t *&data, size_t &length) {
+  if (this->stats_due) {
+    this->stats_due = false;
+    this->begin(Record::FRAME_STATS);
+    this->put32(this->stats.frames);
+    this->put32(this->stats.render_us);
+    this->put32(this->max_render_us);
+    this->put32(this->stats.period_us);
+    this->put16(this->stats.current_ma);
+    this->put16(this->stats.power_mw);
+    this->put16(this->stats.brightness);
+    this->put32(this->stats.late_frames);
+    this->put32(this->stats.dropped_frames);
+    this->put8(this->stats.program);
+    this->put8(this->stats.flags);
+    this->put32(this->stats.program_ram);
+    this->max_render_us = 0;
+  }
+#if FRAME_PROFILER
+  else if (this->profile_stage < (uint8_t)ProfileStage::COUNT) {  // One stage per frame, the whole profile would hold core 1 up
+    const ProfileStage stage = (ProfileStage)this->profile_stage++;
+    const FrameProfiler::StageStats &stage_stats = frame_profiler.stats(stage);
+    const char *name = FrameProfiler::name(stage);
+    const uint8_t name_length = strlen(name);
+    this->begin(Record::PROFILE);
+    this->put8((uint8_t)stage);
+    this->put8(name_length);
+    for (uint8_t i = 0; i < name_length; i++)
+      this->put8(name[i]);
+    this->put32(stage_stats.count);
+    this->put32(stage_stats.max_us);
+    this->put32(stage_stats.total_us);
+    this->put32(stage_stats.total_us >> 32);
+    this->put8(FrameProfiler::BUCKETS);
+    for (uint8_t b = 0; b < FrameProfiler::BUCKETS; b++)
+      this->put32(stage_stats.histogram[b]);
+  }
+#endif
+  else if (this->snapshot_state.load(std::memory_order_acquire) == CAPTURED) {
+    this->begin(Record::SNAPSHOT);
+    this->put8(this->snapshot_width);
+    this->put8(this->snapshot_height);
+    this->put8(this->snapshot_factor);
+    const uint16_t size = this->snapshot_width * this->snapshot_height * 3;
+    memcpy(this->record + this->record_length, this->snapshot, size);
+    this->record_length += size;
+    this->snapshot_state.store(IDLE, std::memory_order_relaxed);
+  }
+  else {
+    return false;
+  }
+  data = this->encoded;
+  length = this->finish();
+  return true;
+}
+
+void Telemetry::begin(Record type) {
+  this->record_length = 0;
+  this->put8(VERSION);
+  this->put8((uint8_t)type);
+  this->put16(this->sequence++);
+}
+
+size_t Telemetry::finish() {
+  this->put16(telemetryCrc16(this->record, this->record_length));
+  const size_t length = cobsEncode(this->record, this->record_length, this->encoded);
+  this->encoded[length] = 0;
+  return length + 1;
+}
+
+uint16_t telemetryCrc16(const uint8_t *data, size_t length) {  // CCITT-FALSE : polynomial 0x1021, from 0xffff
+  uint16_t crc = 0xffff;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+size_t cobsEncode(const uint8_t *in, size_t length, uint8_t *out) {
+  size_t code_index = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < length; i++) {
+    if (in[i]) {
+      out[o++] = in[i];
+      code++;
+    }
+    if (!in[i] || code == 0xff) {  // Ends the block : a 0 byte, or 254 non-zero ones
+      out[code_index] = code;
+      code_index = o++;
+      code = 1;
+    }
+  }
+  out[code_index] = code;
+  return o;
+}
+
+size_t cobsDecode(const uint8_t *in, size_t length, uint8_t *out) {
+  size_t o = 0;
+  for (size_t i = 0; i < length;) {
+    const uint8_t code = in[i++];
+    if (!code || i + code - 1 > length)
+      return 0;
+    for (uint8_t j = 1; j < code; j++) {
+      if (!in[i])
+        return 0;
+      out[o++] = in[i++];
+    }
+    if (code < 0xff && i < length)
+      out[o++] = 0;
+  }
+  return o;
+}
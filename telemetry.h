@@ -0,0 +1,102 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "canvas.h"
+
+// Binary telemetry on the serial port : a few records a second, each costing some microseconds of core 1,
+// in place of a line of text per frame. tools/telemetry_decode.cpp reads them back.
+//
+// A record is
+//   version (1 byte) | type (1) | sequence number (2) | payload | CRC-16/CCITT-FALSE of all the above (2)
+// with its integers little endian, COBS encoded and followed by a 0 byte : a reader that starts in the
+// middle of the stream, or loses bytes, picks up again at the next record. The payloads are written
+// field by field by Telemetry::nextRecord(), and read back in the same order by the decoder. A change
+// of a payload bumps VERSION.
+class Telemetry {
+  public:
+    static constexpr uint8_t VERSION = 2;
+    enum class Record : uint8_t {
+      FRAME_STATS = 1,  // FrameStats, at most every stats interval
+      PROFILE = 2,  // One stage of the frame profiler, when it's built in, all of them every profile interval
+      SNAPSHOT = 3  // The canvas, downsampled to fit SNAPSHOT_BYTES, on request
+    };
+
+    // Of the last frame sent, from what the pipeline computed for it
+    struct FrameStats {
+      uint32_t frames;  // Rendered since boot
+      uint32_t render_us;
+      uint32_t period_us;  // Since the frame before
+      uint16_t current_ma;
+      uint16_t power_mw;
+      uint16_t brightness;  // Thousandths
+      uint32_t late_frames;
+      uint32_t dropped_frames;
+      uint8_t program;
+      uint8_t flags;  // SELECTING_PROGRAM
+      uint32_t program_ram;  // Bytes, see ProgramArena::ramBytes()
+    };
+    static constexpr uint8_t SELECTING_PROGRAM = 1;  // The knob selects the program, not the brightness
+
+    static constexpr uint16_t SNAPSHOT_BYTES = 16 * 16 * 3;  // RGB888
+    static constexpr uint16_t MAX_PAYLOAD = 3 + SNAPSHOT_BYTES;
+    static constexpr uint16_t MAX_RECORD = 4 + MAX_PAYLOAD + 2;
+    static constexpr uint16_t MAX_ENCODED = MAX_RECORD + MAX_RECORD / 254 + 2;  // COBS overhead and the delimiter
+
+  private:
+    enum SnapshotState : uint8_t {IDLE, REQUESTED, CAPTURED};
+
+    const uint32_t stats_interval_us;
+    const uint32_t profile_interval_us;
+    uint16_t sequence = 0;
+
+    // Core 1
+    FrameStats stats = {};
+    uint32_t max_render_us = 0;  // Since the last stats record
+    uint32_t last_stats_us = 0;
+    uint32_t last_profile_us = 0;
+    bool stats_due = false;
+    uint8_t profile_stage = UINT8_MAX;  // Next stage of the profile being sent, UINT8_MAX once all are
+
+    // Written by core 0 between REQUESTED and CAPTURED, read by core 1 from CAPTURED until IDLE
+    std::atomic<uint8_t> snapshot_state{IDLE};
+    uint8_t snapshot_width = 0, snapshot_height = 0, snapshot_factor = 1;
+    uint8_t snapshot[SNAPSHOT_BYTES];
+
+    uint8_t record[MAX_RECORD];
+    uint16_t record_length = 0;
+    uint8_t encoded[MAX_ENCODED];
+
+    void frameSent(uint32_t now_us, const FrameStats &stats);
+    bool nextRecord(const uint8_t *&data, size_t &length);  // The next record due, encoded
+    void begin(Record type);
+    void put8(uint8_t value) {this->record[this->record_length++] = value;}
+    void put16(uint16_t value) {this->put8(value); this->put8(value >> 8);}
+    void put32(uint32_t value) {this->put16(value); this->put16(value >> 16);}
+    size_t finish();  // Adds the CRC and encodes the record
+
+  public:
+    Telemetry(uint32_t stats_interval_us, uint32_t profile_interval_us) : stats_interval_us(stats_interval_us), profile_interval_us(profile_interval_us) {};
+
+    // Core 1, once a frame was sent : writes the records that are due, with out.write(const uint8_t *, size_t) as Serial's
+    template <typename Output> void send(Output &out, uint32_t now_us, const FrameStats &stats) {
+      this->frameSent(now_us, stats);
+      const uint8_t *data;
+      size_t length;
+      while (this->nextRecord(data, length))
+        out.write(data, length);
+    }
+    void requestProfile();  // Core 1, sends the whole profile from the next frame on
+    void requestSnapshot();  // Core 1, sends the next frame core 0 renders
+
+    // Core 0, once the frame is drawn
+    bool snapshotRequested() const {return this->snapshot_state.load(std::memory_order_acquire) == REQUESTED;}
+    void captureSnapshot(const Canvas &canvas);
+};
+
+uint16_t telemetryCrc16(const uint8_t *data, size_t length);
+size_t cobsEncode(const uint8_t *in, size_t length, uint8_t *out);  // Returns the encoded length, without the delimiter
+size_t cobsDecode(const uint8_t *in, size_t length, uint8_t *out);  // Returns the decoded length, 0 if malformed
+
+#endif
@@ -0,0 +1,201 @@
+// Checks CellularAutomaton against a naive reference that keeps a byte per cell : the row shifts, Life-like
+// rules and falling sand, on widths around the word boundaries (the carries between words, and the columns
+// past the panel in the last word, which must stay off), with and without wrapping.
+// Host tool, built by CMakeLists.txt with the others : build/cellular_automaton_check with 64 bits words,
+// and build/cellular_automaton_check_32 with the 32 bits ones of the Pico.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "cellular_automaton.h"
+
+typedef CellularAutomaton::Word Word;
+typedef std::vector<uint8_t> Cells;  // Naive state, row-major
+
+static const int WIDTHS[] = {1, 2, 3, 16, 31, 32, 33, 63, 64, 65, 70, 130};
+static const int HEIGHTS[] = {1, 2, 3, 9};
+static const uint32_t SEED = 12345;
+
+static Cells randomCells(int w, int h, int percent) {
+  Cells cells(w * h);
+  for (uint8_t &cell : cells)
+    cell = rand() % 100 < percent;
+  return cells;
+}
+
+static void load(CellularAutomaton &automaton, const Cells &cells) {
+  automaton.clear();
+  for (int y = 0; y < automaton.height(); y++)
+    for (int x = 0; x < automaton.width(); x++)
+      automaton.set(x, y, cells[y * automaton.width() + x]);
+}
+
+// Cells that differ from the reference, and columns past the panel that are on
+static int mismatches(const CellularAutomaton &automaton, const Cells &cells) {
+  const int w = automaton.width();
+  int errors = 0;
+  for (int y = 0; y < automaton.height(); y++) {
+    for (int x = 0; x < w; x++)
+      errors += automaton.get(x, y) != (bool)cells[y * w + x];
+    const int last_columns = w - (automaton.wordsPerRow() - 1) * CellularAutomaton::WORD_BITS;
+    if (last_columns < CellularAutomaton::WORD_BITS)
+      errors += (automaton.row(y)[automaton.wordsPerRow() - 1] >> last_columns) != 0;
+  }
+  return errors;
+}
+
+// Random rows, shifted both ways : out column x is in column x - 1 for shiftRight, x + 1 for shiftLeft
+static int checkShifts() {
+  int errors = 0;
+  for (int w : WIDTHS) {
+    for (bool wrap : {false, true}) {
+      CellularAutomaton automaton(w, 3);
+      for (int run = 0; run < 50; run++) {
+        const Cells row = randomCells(w, 1, 50);
+        load(automaton, row);
+        automaton.shiftRight(automaton.row(1), automaton.row(0), wrap);
+        automaton.shiftLeft(automaton.row(2), automaton.row(0), wrap);
+        Cells expected = row;
+        for (int x = 0; x < w; x++) {
+          expected.push_back(x > 0 ? row[x - 1] : wrap && row[w - 1]);
+        }
+        for (int x = 0; x < w; x++) {
+          expected.push_back(x < w - 1 ? row[x + 1] : wrap && row[0]);
+        }
+        errors += mismatches(automaton, expected);
+      }
+    }
+  }
+  printf("shifts : %d cells wrong\n", errors);
+  return errors;
+}
+
+static Cells naiveLife(const Cells &cells, int w, int h, uint16_t birth, uint16_t survival, bool wrap) {
+  Cells next(w * h);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      int n = 0;
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          int nx = x + dx, ny = y + dy;
+          if (wrap) {  // A neighbour that wraps onto the cell itself, or twice onto the same one, still counts
+            nx = (nx + w) % w;
+            ny = (ny + h) % h;
+          }
+          else if (nx < 0 || ny < 0 || nx >= w || ny >= h)
+            continue;
+          n += (dx || dy) && cells[ny * w + nx];
+        }
+      }
+      next[y * w + x] = ((cells[y * w + x] ? survival : birth) >> n) & 1;
+    }
+  }
+  return next;
+}
+
+// Random rules, Conway's among them, from random states
+static int checkLife() {
+  int errors = 0, generations = 0;
+  for (int w : WIDTHS) {
+    for (int h : HEIGHTS) {
+      for (bool wrap : {false, true}) {
+        CellularAutomaton automaton(w, h), next(w, h);
+        for (int rule = 0; rule < 8; rule++) {
+          const uint16_t birth = rule == 0 ? 1 << 3 : rand() & 0x1ff;
+          const uint16_t survival = rule == 0 ? 1 << 2 | 1 << 3 : rand() & 0x1ff;
+          Cells cells = randomCells(w, h, 10 + rand() % 50);
+          load(automaton, cells);
+          for (int generation = 0; generation < 12; generation++, generations++) {
+            automaton.stepLife(next, birth, survival, wrap);
+            automaton.swap(next);
+            cells = naiveLife(cells, w, h, birth, survival, wrap);
+            const int wrong = mismatches(automaton, cells);
+            if (wrong && !errors)
+              printf("  first difference : %dx%d%s, B%03x/S%03x, generation %d\n", w, h, wrap ? " wrapping" : "", birth, survival, generation);
+            errors += wrong;
+          }
+        }
+      }
+    }
+  }
+  printf("life : %d generations, %d cells wrong\n", generations, errors);
+  return errors;
+}
+
+// Same rule as stepSand(), a cell at a time, drawing from rand() in the same order
+static void naiveSand(Cells &cells, const Cells &walls, int w, int h) {
+  auto isFree = [&](int x, int y) {return x >= 0 && x < w && !cells[y * w + x] && !walls[y * w + x];};
+  for (int y = h - 2; y >= 0; y--) {
+    for (int x = 0; x < w; x++) {
+      if (cells[y * w + x] && isFree(x, y + 1)) {
+        cells[y * w + x] = 0;
+        cells[(y + 1) * w + x] = 1;
+      }
+    }
+    const bool right_first = rand() % 2;
+    for (int side = 0; side < 2; side++) {
+      const int dx = (side == 0) == right_first ? 1 : -1;
+      std::vector<int> moving;  // All the cells of a side move at once
+      for (int x = 0; x < w; x++)
+        if (cells[y * w + x] && isFree(x + dx, y + 1) && isFree(x + dx, y))
+          moving.push_back(x);
+      for (int x : moving) {
+        cells[y * w + x] = 0;
+        cells[(y + 1) * w + x + dx] = 1;
+      }
+    }
+  }
+}
+
+// Random walls and grains : the grains must end where the reference puts them, none lost or in a wall, and
+// the moves reported must take the previous state to the new one, a free cell below at a time
+static int checkSand() {
+  int errors = 0, bad_moves = 0, steps = 0;
+  for (int w : WIDTHS) {
+    for (int h : {1, 2, 3, 12}) {
+      for (int run = 0; run < 4; run++) {
+        CellularAutomaton sand(w, h), walls(w, h);
+        const Cells wall_cells = randomCells(w, h, 15);
+        Cells cells = randomCells(w, h, 40);
+        for (int i = 0; i < w * h; i++)
+          cells[i] &= !wall_cells[i];
+        load(walls, wall_cells);
+        load(sand, cells);
+        const int grains = sand.count();
+        for (int step = 0; step < 16; step++, steps++) {
+          Cells replayed = cells;
+          const unsigned seed = rand();
+          srand(seed);
+          sand.stepSand(walls, [&](int x, int y, int to_x, int to_y) {
+            const bool valid = to_y == y + 1 && abs(to_x - x) <= 1 && to_x >= 0 && to_x < w && to_y < h &&
+              replayed[y * w + x] && !replayed[to_y * w + to_x] && !wall_cells[to_y * w + to_x];
+            if (valid) {
+              replayed[y * w + x] = 0;
+              replayed[to_y * w + to_x] = 1;
+            }
+            bad_moves += !valid;
+          });
+          srand(seed);
+          naiveSand(cells, wall_cells, w, h);
+          int wrong = mismatches(sand, cells) + mismatches(sand, replayed) + (sand.count() != grains);
+          for (int i = 0; i < w * h; i++)
+            wrong += cells[i] && wall_cells[i];
+          if (wrong && !errors)
+            printf("  first difference : %dx%d, run %d, step %d\n", w, h, run, step);
+          errors += wrong;
+        }
+      }
+    }
+  }
+  printf("sand : %d steps, %d cells wrong, %d bad moves\n", steps, errors, bad_moves);
+  return errors + bad_moves;
+}
+
+int main() {
+  srand(SEED);
+  printf("%d bits words\n", CellularAutomaton::WORD_BITS);
+  int errors = checkShifts();
+  errors += checkLife();
+  errors += checkSand();
+  printf(errors ? "FAILED\n" : "OK\n");
+  return errors ? 1 : 0;
+}
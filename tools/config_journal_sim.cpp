@@ -0,0 +1,145 @@
+// Runs the config journal on a simulated flash image : wear levelling over many saves, and saves cut by
+// a power loss at random points of the erase or the program, after which a reboot must find either
+// the config from before the save or the new one, never anything else.
+// Host tool, built by CMakeLists.txt with the others : build/config_journal_sim
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "config_journal.h"
+
+static const uint8_t SECTORS = 4;
+static const uint32_t JOURNAL_OFFSET = 8 * FlashBackend::SECTOR_SIZE;  // Somewhere in the image, not at 0
+static const uint8_t VERSION = 1;
+
+struct Config {  // Same layout as AppConfig
+  int selected_program;
+  float brightness;
+  bool operator==(const Config &other) const {return memcmp(this, &other, sizeof(Config)) == 0;}
+};
+
+struct PowerLoss {};
+
+// NOR flash image. power_budget counts the bytes that can still be erased or programmed before the
+// power goes : the byte being written then is left half done, and the rest of the operation never happens.
+class SimulatedFlash : public FlashBackend {
+  private:
+    std::vector<uint8_t> image;
+
+  public:
+    int64_t power_budget = -1;  // -1 for no power loss
+    std::vector<uint32_t> sector_erases;
+    uint32_t pages_programmed = 0;
+
+    SimulatedFlash(uint32_t sectors) : image(sectors * SECTOR_SIZE, 0xff), sector_erases(sectors, 0) {}
+
+    void read(uint32_t offset, void *data, uint32_t length) override {memcpy(data, &this->image[offset], length);}
+
+    void erase(uint32_t offset) override {
+      this->sector_erases[offset / SECTOR_SIZE]++;
+      for (uint32_t i = 0; i < SECTOR_SIZE; i++) {
+        if (this->power_budget == 0) {
+          for (uint32_t j = i; j < SECTOR_SIZE; j++)  // Partly erased bits
+            this->image[offset + j] |= rand();
+          throw PowerLoss();
+        }
+        if (this->power_budget > 0)
+          this->power_budget--;
+        this->image[offset + i] = 0xff;
+      }
+    }
+
+    void program(uint32_t offset, const uint8_t *page) override {
+      this->pages_programmed++;
+      for (uint32_t i = 0; i < PAGE_SIZE; i++) {
+        if (this->power_budget == 0) {
+          this->image[offset + i] &= page[i] | rand();  // Partly programmed bits
+          throw PowerLoss();
+        }
+        if (this->power_budget > 0)
+          this->power_budget--;
+        this->image[offset + i] &= page[i];  // Programming can only clear bits
+      }
+    }
+};
+
+static Config randomConfig() {
+  return {rand() % 22, (rand() % 1000) / 1000.0f};
+}
+
+static bool wearTest() {
+  const uint32_t SAVES = 100000;
+  SimulatedFlash flash(JOURNAL_OFFSET / FlashBackend::SECTOR_SIZE + SECTORS);
+  ConfigJournal journal(flash, JOURNAL_OFFSET, SECTORS);
+  Config config, loaded;
+  uint32_t wrong = 0;
+  for (uint32_t i = 0; i < SAVES; i++) {
+    config = randomConfig();
+    journal.save(VERSION, &config, sizeof(config));
+    if (i % 97 == 0) {  // As after a reboot
+      ConfigJournal rebooted(flash, JOURNAL_OFFSET, SECTORS);
+      wrong += !rebooted.load(VERSION, &loaded, sizeof(loaded)) || !(loaded == config);
+    }
+  }
+  uint32_t min_erases = UINT32_MAX, max_erases = 0;
+  for (uint8_t s = 0; s < SECTORS; s++) {
+    const uint32_t erases = flash.sector_erases[JOURNAL_OFFSET / FlashBackend::SECTOR_SIZE + s];
+    min_erases = std::min(min_erases, erases);
+    max_erases = std::max(max_erases, erases);
+  }
+  printf("wear       : %u saves, %u to %u erases per sector (%.1f saves per erase), %u wrong loads\n",
+    SAVES, min_erases, max_erases, SAVES / (double)(max_erases * SECTORS), wrong);
+  return wrong == 0 && max_erases - min_erases <= 1;
+}
+
+static bool powerLossTest() {
+  const uint32_t TRIALS = 200000;
+  SimulatedFlash flash(JOURNAL_OFFSET / FlashBackend::SECTOR_SIZE + SECTORS);
+  Config committed = {};
+  bool has_committed = false;
+  uint32_t power_losses = 0, wrong = 0, lost = 0, new_kept = 0;
+  for (uint32_t trial = 0; trial < TRIALS; trial++) {
+    ConfigJournal journal(flash, JOURNAL_OFFSET, SECTORS);  // Every trial starts from a reboot
+    const Config config = randomConfig();
+    // Often enough within a page program, sometimes within a sector erase
+    flash.power_budget = rand() % 4 == 0 ? rand() % (FlashBackend::SECTOR_SIZE + 2 * FlashBackend::PAGE_SIZE) : rand() % FlashBackend::PAGE_SIZE;
+    bool saved = true;
+    try {
+      journal.save(VERSION, &config, sizeof(config));
+    } catch (PowerLoss &) {
+      saved = false;
+      power_losses++;
+    }
+    flash.power_budget = -1;
+
+    ConfigJournal rebooted(flash, JOURNAL_OFFSET, SECTORS);
+    Config loaded;
+    const bool found = rebooted.load(VERSION, &loaded, sizeof(loaded));
+    if (saved) {
+      wrong += !found || !(loaded == config);
+    } else if (found && loaded == config) {
+      new_kept++;  // The power went on the very last bits, which were already right
+    } else if (has_committed) {
+      lost += !found;
+      wrong += found && !(loaded == committed);
+    } else {
+      wrong += found;
+    }
+    if (found) {
+      committed = loaded;
+      has_committed = true;
+    }
+  }
+  printf("power loss : %u saves, %u cut by a power loss (%u after the record was complete), %u configs lost, %u wrong, %u pages programmed\n",
+    TRIALS, power_losses, new_kept, lost, wrong, flash.pages_programmed);
+  return lost == 0 && wrong == 0;
+}
+
+int main() {
+  srand(1);
+  bool ok = wearTest();
+  ok &= powerLossTest();
+  printf(ok ? "OK\n" : "FAILED\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// Error bounds and speed of fast_math.h against libm.
+// Host tool, built by CMakeLists.txt with the others : build/fast_math_bench
+// The timings are only relative to the host's libm and FPU, which are far cheaper than the RP2040's
+// soft-float routines (the host even has a sqrt instruction, which isqrt32 can't beat) ; the error
+// bounds are what the comments of fast_math.h quote.
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "fast_math.h"
+
+static const double PI = 3.14159265358979323846;
+static const int RUNS = 20;
+
+static volatile float sink_float;
+static volatile int32_t sink_int;
+
+template <typename F>
+static double nsPerCall(int n, F f) {
+  double best = 1e30;
+  for (int run = 0; run < RUNS; run++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / n);
+  }
+  return best;
+}
+
+static double angleError(angle16 a, double reference) {  // Distance on the circle, in radians
+  double diff = fmod(a * 2 * PI / 65536 - reference, 2 * PI);
+  if (diff > PI) diff -= 2 * PI;
+  if (diff < -PI) diff += 2 * PI;
+  return fabs(diff);
+}
+
+int main() {
+  // Errors
+  double sin16_error = 0;
+  for (uint32_t a = 0; a < 65536; a++)
+    sin16_error = std::max(sin16_error, fabs(sin16(a) / 32767.0 - sin(a * 2 * PI / 65536)));
+
+  double fast_sin_error = 0;
+  for (int i = -2000000; i <= 2000000; i++) {
+    const float x = i * 1e-4f;  // -200 to 200 radians
+    fast_sin_error = std::max(fast_sin_error, fabs((double)fastSin(x) - sin((double)x)));
+    fast_sin_error = std::max(fast_sin_error, fabs((double)fastCos(x) - cos((double)x)));
+  }
+
+  int whole_radians_error = 0;
+  for (int32_t n = -100000; n <= 100000; n++) {
+    const double exact = fmod(n * 65536.0 / (2 * PI), 65536);
+    int diff = abs((int)(angle16WholeRadians(n) - (int32_t)floor(exact < 0 ? exact + 65536 : exact)) % 65536);
+    whole_radians_error = std::max(whole_radians_error, std::min(diff, 65536 - diff));
+  }
+
+  double atan2_error = 0;
+  for (int y = -300; y <= 300; y++)
+    for (int x = -300; x <= 300; x++)
+      if (x || y)
+        atan2_error = std::max(atan2_error, angleError(atan2_16(y, x), atan2(y, x)));
+  uint32_t seed = 1;
+  for (int i = 0; i < 1000000; i++) {  // Large and mixed magnitudes
+    seed = seed * 1664525 + 1013904223;
+    int32_t y = (int32_t)seed >> (seed & 15);
+    seed = seed * 1664525 + 1013904223;
+    int32_t x = (int32_t)seed >> (seed & 15);
+    if (x || y)
+      atan2_error = std::max(atan2_error, angleError(atan2_16(y, x), atan2((double)y, (double)x)));
+  }
+
+  uint32_t isqrt_failures = 0;
+  for (uint64_t v = 0; v <= 0xffffffffULL; v += (v < (1 << 24) ? 1 : 65521)) {
+    uint64_t r = isqrt32(v);
+    if (r * r > v || (r + 1) * (r + 1) <= v)
+      isqrt_failures++;
+  }
+  for (uint64_t r = 1; r < 65536; r++) {  // Around every perfect square
+    if (isqrt32(r * r) != r || isqrt32(r * r - 1) != r - 1)
+      isqrt_failures++;
+  }
+
+  double inv_sqrt_error = 0;
+  for (float v = 1e-6f; v < 1e6f; v *= 1.0001f)
+    inv_sqrt_error = std::max(inv_sqrt_error, fabs(fastInvSqrt(v) * sqrt((double)v) - 1));
+
+  printf("sin16 / cos16       max error %.2e (%.2f LSB of Q1.15)\n", sin16_error, sin16_error * 32767);
+  printf("fastSin / fastCos   max error %.2e\n", fast_sin_error);
+  printf("angle16WholeRadians max error %d unit\n", whole_radians_error);
+  printf("atan2_16            max error %.2e radians (%.2f unit)\n", atan2_error, atan2_error * 65536 / (2 * PI));
+  printf("isqrt32             %u wrong results\n", isqrt_failures);
+  printf("fastInvSqrt         max relative error %.2e\n", inv_sqrt_error);
+
+  // Speed
+  const int N = 1 << 16;
+  std::vector<float> radians(N);
+  std::vector<int32_t> ints(N);
+  for (int i = 0; i < N; i++) {
+    radians[i] = (i - N / 2) * 0.001f;
+    ints[i] = (i * 7919) % 2001 - 1000;
+  }
+  printf("\nns per call          libm   fast\n");
+  printf("sin                %6.2f %6.2f\n",
+    nsPerCall(N, [&] {float s = 0; for (float r : radians) s += sinf(r); sink_float = s;}),
+    nsPerCall(N, [&] {float s = 0; for (float r : radians) s += fastSin(r); sink_float = s;}));
+  printf("sin16 (angle16)           %6.2f\n",
+    nsPerCall(N, [&] {int32_t s = 0; for (int i = 0; i < N; i++) s += sin16(i * 40503); sink_int = s;}));
+  printf("atan2              %6.2f %6.2f\n",
+    nsPerCall(N, [&] {float s = 0; for (int i = 0; i < N; i++) s += atan2f(ints[i], ints[N - 1 - i]); sink_float = s;}),
+    nsPerCall(N, [&] {int32_t s = 0; for (int i = 0; i < N; i++) s += atan2_16(ints[i], ints[N - 1 - i]); sink_int = s;}));
+  printf("sqrt (integer)     %6.2f %6.2f\n",
+    nsPerCall(N, [&] {int32_t s = 0; for (int i = 0; i < N; i++) s += (int32_t)sqrtf((uint32_t)i * 65521); sink_int = s;}),
+    nsPerCall(N, [&] {int32_t s = 0; for (int i = 0; i < N; i++) s += isqrt32((uint32_t)i * 65521); sink_int = s;}));
+  printf("1/sqrt             %6.2f %6.2f\n",
+    nsPerCall(N, [&] {float s = 0; for (int i = 1; i <= N; i++) s += 1 / sqrtf(i); sink_float = s;}),
+    nsPerCall(N, [&] {float s = 0; for (int i = 1; i <= N; i++) s += fastInvSqrt(i); sink_float = s;}));
+  return 0;
+}
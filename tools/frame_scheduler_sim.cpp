@@ -0,0 +1,60 @@
+// Runs the frame scheduler against a simulated clock, with programs of various render costs, and checks
+// that the animation keeps its speed : a frame must show the animation time of the moment it is displayed.
+// Host tool, built by CMakeLists.txt with the others : build/frame_scheduler_sim
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include "frame_scheduler.h"
+
+static const float FRAMERATE = 31;  // Same as main.ino
+static const double SECONDS = 60;
+
+struct Load {
+  const char *name;
+  uint32_t (*render_us)(uint32_t frame);
+};
+
+static const Load LOADS[] = {
+  {"light, 8 ms", [](uint32_t frame) -> uint32_t {return 8000;}},
+  {"at the limit, 32 ms", [](uint32_t frame) -> uint32_t {return 32000;}},
+  {"overrunning, 45 ms", [](uint32_t frame) -> uint32_t {return 45000;}},
+  {"100 ms spike every 2 s", [](uint32_t frame) -> uint32_t {return frame % 62 == 0 ? 100000 : 10000;}},
+  {"jittery, 5 to 40 ms", [](uint32_t frame) -> uint32_t {return 5000 + (frame * 7919) % 35000;}},
+};
+
+int main() {
+  printf("%-24s %7s %7s %7s %9s %12s %14s\n", "load", "shown", "late", "dropped", "shown fps", "max lateness", "anim. speed");
+  for (const Load &load : LOADS) {
+    FrameScheduler scheduler(FRAMERATE);
+    const uint64_t start = 1000000;
+    scheduler.start(start, 100);
+    uint64_t now = start;
+    uint64_t last_shown = 0;
+    double first_time = 0, last_time = 0;
+    uint64_t first_shown = 0;
+    uint32_t shown = 0;
+    while (now < start + SECONDS * 1e6) {
+      // The pipeline lets the renderer get at most one frame ahead of the display
+      now = std::max(now, scheduler.deadline() - 2 * scheduler.period());
+      const double time = scheduler.time();
+      const uint64_t deadline = scheduler.deadline();
+      now += load.render_us(shown);
+      scheduler.frameRendered(now);
+      // Shown at its deadline, or as soon as it's done if late, and never before the previous one
+      const uint64_t show_at = std::max(std::max(deadline, now), last_shown);
+      if (shown == 0) {
+        first_time = time;
+        first_shown = show_at;
+      }
+      last_time = time;
+      last_shown = show_at;
+      shown++;
+    }
+    const FrameScheduler::Stats &stats = scheduler.getStats();
+    // Animation time elapsed over wall time elapsed, between the first and the last frame shown
+    const double speed = (last_time - first_time) / ((last_shown - first_shown) * 1e-6);
+    printf("%-24s %7u %7u %7u %9.2f %9.1f ms %14.4f\n", load.name, shown, stats.late_frames, stats.dropped_frames,
+      shown / SECONDS, stats.max_lateness_us / 1000.0, speed);
+  }
+  return 0;
+}
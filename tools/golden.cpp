@@ -0,0 +1,337 @@
+// Golden frames : renders every program through a fixed sequence of frames (rand() seeded, animation time
+// injected, nothing else varies), and either records them as the reference, or compares them with a
+// reference recorded earlier.
+// Host tool, built by CMakeLists.txt with the others : build/golden
+//   build/golden record golden/         Before a change, from a build of the code as it was (creates golden/)
+//   build/golden check golden/          After it, fails if a program looks different
+//   build/golden check golden/ --diff golden/diff/
+// The first 10 s of every program are kept (--frames), at the size of the panel (--size), about 5MB in all.
+// A reference holds the hash of every frame, so identical frames are found without looking at them, and
+// the frames themselves. A frame that changed still passes if it is within the tolerance of its program,
+// either on its largest channel difference or on its PSNR, so that changes of arithmetic that nobody can
+// see (fixed point, lookup tables, another rounding) don't fail. With --diff, the worst frame of every
+// program that fails is written as a PPM : reference, new frame and difference, side by side.
+//
+// The tool is built with AddressSanitizer in recover mode : an access out of a program's maps or canvas is
+// reported on stderr as it happens, rendering goes on, and the program is flagged in the summary with the
+// frame of its first error. So is an access out of a Grid, which is checked as well (see grid.h), and a
+// noise coordinate out of range (see simplex_noise.h). Every faulty instruction is only reported once. As
+// some errors take a while to show up (a grain of sand that reaches the left edge), programs run on for
+// 100 s (--run) after the frames that are kept.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include "program_registry.h"
+#include "simplex_noise.h"
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#endif
+
+static const float FRAMERATE = 31;  // Same as main.ino
+static const uint32_t SEED = 1;
+static const char MAGIC[8] = {'G', 'O', 'L', 'D', 'E', 'N', '1', '\n'};
+
+// A frame passes if its largest channel difference is at most max_delta, or if its PSNR is at least min_psnr
+struct Tolerance {
+  const char *program;
+  int max_delta;
+  double min_psnr;  // dB
+};
+
+static const Tolerance DEFAULT_TOLERANCE = {nullptr, 2, 45};
+static const Tolerance TOLERANCES[] = {
+  // A plain color has nothing to round
+  {"static_white", 0, INFINITY},
+  {"static_warm_yellow", 0, INFINITY},
+  {"static_red", 0, INFINITY},
+  {"static_green", 0, INFINITY},
+  {"static_blue", 0, INFINITY},
+  // Simulations with random draws and branches : once a grain, drop or ball goes elsewhere, the two runs
+  // diverge for good and no tolerance makes sense, they must stay exact
+  {"falling_sand", 0, INFINITY},
+  {"lava_lamp", 0, INFINITY},
+  {"matrix_effect", 0, INFINITY},
+  {"ripples", 0, INFINITY},
+  // Blurred, or drawn from noise : small errors spread over many pixels
+  {"perlin_fire", 4, 40},
+  {"spectral_perlin_fire", 4, 40},
+  {"vortex", 4, 40},
+  {"rotating_kaleidoscope", 4, 40},
+  {"octopus", 4, 40},
+  {"bursts", 4, 40},
+};
+
+static const Tolerance &toleranceOf(const char *program) {
+  for (const Tolerance &tolerance : TOLERANCES)
+    if (strcmp(tolerance.program, program) == 0)
+      return tolerance;
+  return DEFAULT_TOLERANCE;
+}
+
+struct Frame {
+  uint64_t hash;
+  std::vector<uint8_t> rgb;  // Row-major
+};
+
+static uint64_t fnv1a(const uint8_t *data, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ data[i]) * 0x100000001b3;
+  return hash;
+}
+
+// Memory errors (out of bounds accesses mostly) reported by AddressSanitizer or the Grid checks while rendering the current program
+static int memory_errors = 0;
+static int first_error_frame;
+static std::string first_error;
+static int rendered_frame;
+
+#if defined(__SANITIZE_ADDRESS__)
+extern "C" const char *__asan_default_options() {
+  return "halt_on_error=0:detect_leaks=0";  // Every faulty instruction is reported once, and rendering goes on
+}
+
+static void asanReport(const char *report) {
+  if (memory_errors++ == 0) {
+    const char *line = strstr(report, "AddressSanitizer: ");
+    const char *end = line ? strstr(line, " on ") : nullptr;  // Only the kind of error, the rest is in the report on stderr
+    first_error = line ? std::string(line + strlen("AddressSanitizer: "), end ? end : line + strcspn(line, "\n")) : "";
+    first_error_frame = rendered_frame;
+  }
+}
+#endif
+
+#if GRID_BOUNDS_CHECK
+static void gridReport(int x, int y, int width, int height) {
+  if (memory_errors++ == 0) {  // Every access is, only the first one is printed
+    fprintf(stderr, "Grid access out of bounds : (%d, %d) in %dx%d\n", x, y, width, height);
+    first_error = "grid-out-of-bounds";
+    first_error_frame = rendered_frame;
+  }
+}
+
+static void noiseReport(float coordinate) {
+  if (memory_errors++ == 0) {
+    fprintf(stderr, "Noise coordinate out of range : %g\n", coordinate);
+    first_error = "noise-coordinate-out-of-range";
+    first_error_frame = rendered_frame;
+  }
+}
+#endif
+
+// The first frames are kept, the program then runs on until run_frames, for the memory check only
+static std::vector<Frame> render(uint8_t index, int size, int frames, int run_frames) {
+  static ProgramArena arena;
+  srand(SEED);  // Programs draw from rand() as soon as they are built
+  WS2812MatrixProgram *program = arena.load(index, size, size);
+  Canvas canvas(size, size);
+  std::vector<Frame> result(frames);
+  for (int f = 0; f < std::max(frames, run_frames); f++) {
+    rendered_frame = f;
+    program->iterate(canvas, f / FRAMERATE);
+    if (f >= frames)
+      continue;
+    Frame &frame = result[f];
+    frame.rgb.resize(size * size * 3);
+    for (int i = 0; i < size * size; i++) {
+      const uint32_t color = canvas.data()[i];
+      frame.rgb[i * 3] = color >> 16;
+      frame.rgb[i * 3 + 1] = color >> 8;
+      frame.rgb[i * 3 + 2] = color;
+    }
+    frame.hash = fnv1a(frame.rgb.data(), frame.rgb.size());
+  }
+  rendered_frame = -1;  // Destruction
+  arena.unload();
+  return result;
+}
+
+// The directory itself, its parents must exist
+static bool makeDirectory(const char *dir) {
+  if (mkdir(dir, 0777) == 0 || errno == EEXIST)
+    return true;
+  fprintf(stderr, "Can't create %s : %s\n", dir, strerror(errno));
+  return false;
+}
+
+static std::string referencePath(const std::string &dir, const char *program) {
+  return dir + "/" + program + ".golden";
+}
+
+// MAGIC, size and frame count as uint32, then the hash and the RGB bytes of every frame
+static bool writeReference(const std::string &path, int size, const std::vector<Frame> &frames) {
+  FILE *out = fopen(path.c_str(), "wb");
+  if (!out)
+    return false;
+  const uint32_t header[2] = {(uint32_t)size, (uint32_t)frames.size()};
+  fwrite(MAGIC, 1, sizeof(MAGIC), out);
+  fwrite(header, sizeof(header), 1, out);
+  for (const Frame &frame : frames) {
+    fwrite(&frame.hash, sizeof(frame.hash), 1, out);
+    fwrite(frame.rgb.data(), 1, frame.rgb.size(), out);
+  }
+  return fclose(out) == 0;
+}
+
+static bool readReference(const std::string &path, int &size, std::vector<Frame> &frames) {
+  FILE *in = fopen(path.c_str(), "rb");
+  if (!in)
+    return false;
+  char magic[sizeof(MAGIC)];
+  uint32_t header[2];
+  bool ok = fread(magic, 1, sizeof(magic), in) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+    && fread(header, sizeof(header), 1, in) == 1 && header[0] > 0 && header[0] <= 1024;
+  if (ok) {
+    size = header[0];
+    frames.resize(header[1]);
+    for (Frame &frame : frames) {
+      frame.rgb.resize(size * size * 3);
+      ok &= fread(&frame.hash, sizeof(frame.hash), 1, in) == 1 && fread(frame.rgb.data(), 1, frame.rgb.size(), in) == frame.rgb.size();
+    }
+  }
+  fclose(in);
+  return ok;
+}
+
+struct Comparison {
+  int max_delta = 0;
+  double psnr = INFINITY;
+};
+
+static Comparison compare(const Frame &a, const Frame &b) {
+  Comparison comparison;
+  if (a.hash == b.hash && a.rgb == b.rgb)
+    return comparison;
+  double squared = 0;
+  for (size_t i = 0; i < a.rgb.size(); i++) {
+    const int delta = abs(a.rgb[i] - b.rgb[i]);
+    comparison.max_delta = std::max(comparison.max_delta, delta);
+    squared += delta * delta;
+  }
+  comparison.psnr = squared > 0 ? 10 * log10(255.0 * 255.0 / (squared / a.rgb.size())) : INFINITY;
+  return comparison;
+}
+
+// Reference, new frame and their difference (amplified 4 times), scaled up 8 times
+static void writeDiff(const std::string &path, int size, const Frame &reference, const Frame &frame) {
+  const int SCALE = 8, GAP = 1;
+  const int w = (3 * size + 2 * GAP) * SCALE, h = size * SCALE;
+  FILE *out = fopen(path.c_str(), "wb");
+  if (!out)
+    return;
+  fprintf(out, "P6\n%d %d\n255\n", w, h);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      const int panel = x / SCALE / (size + GAP), px = x / SCALE % (size + GAP);
+      uint8_t pixel[3] = {64, 64, 64};
+      if (px < size) {
+        const int i = ((y / SCALE) * size + px) * 3;
+        for (int c = 0; c < 3; c++)
+          pixel[c] = panel == 0 ? reference.rgb[i + c] : panel == 1 ? frame.rgb[i + c] : std::min(255, 4 * abs(reference.rgb[i + c] - frame.rgb[i + c]));
+      }
+      fwrite(pixel, 1, 3, out);
+    }
+  }
+  fclose(out);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3 || (strcmp(argv[1], "record") != 0 && strcmp(argv[1], "check") != 0)) {
+    fprintf(stderr, "Usage : %s record|check DIR [--frames N] [--run N] [--size N] [--program NAME] [--diff DIR]\n", argv[0]);
+    return 1;
+  }
+  const bool record = strcmp(argv[1], "record") == 0;
+  const std::string dir = argv[2];
+  int frames = 10 * FRAMERATE, run_frames = 100 * FRAMERATE, size = 16;
+  const char *only = nullptr, *diff_dir = nullptr;
+  for (int i = 3; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--frames") == 0)
+      frames = std::max(1, atoi(argv[i + 1]));
+    else if (strcmp(argv[i], "--run") == 0)
+      run_frames = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--size") == 0)
+      size = std::max(1, std::min(1024, atoi(argv[i + 1])));
+    else if (strcmp(argv[i], "--program") == 0)
+      only = argv[i + 1];
+    else if (strcmp(argv[i], "--diff") == 0)
+      diff_dir = argv[i + 1];
+  }
+#if defined(__SANITIZE_ADDRESS__)
+  __asan_set_error_report_callback(asanReport);
+#else
+  fprintf(stderr, "Built without AddressSanitizer, memory errors aren't detected\n");
+#endif
+#if GRID_BOUNDS_CHECK
+  grid_bounds_handler = gridReport;
+  noise_range_handler = noiseReport;
+#endif
+  if ((record && !makeDirectory(dir.c_str())) || (diff_dir && !makeDirectory(diff_dir)))
+    return 1;
+
+  int failures = 0, flagged = 0;
+  for (uint8_t index = 0; index < ProgramRegistry::size(); index++) {
+    const ProgramRegistry::Entry &program = ProgramRegistry::get(index);
+    if (only && strcmp(only, program.name) != 0)
+      continue;
+    memory_errors = 0;
+    printf("%-22s ", program.name);
+    bool failed = false;
+
+    if (record) {
+      const std::vector<Frame> result = render(index, size, frames, run_frames);
+      const std::string path = referencePath(dir, program.name);
+      failed = !writeReference(path, size, result);
+      if (failed)
+        printf("can't write %s : %s", path.c_str(), strerror(errno));
+      else
+        printf("recorded");
+    }
+    else {
+      int reference_size;
+      std::vector<Frame> reference;
+      if (!readReference(referencePath(dir, program.name), reference_size, reference)) {
+        printf("no reference\n");
+        failures++;
+        continue;
+      }
+      // Always the frames of the reference, whatever the options
+      const std::vector<Frame> result = render(index, reference_size, reference.size(), run_frames);
+      const Tolerance &tolerance = toleranceOf(program.name);
+      int changed = 0, over = 0, worst = -1;
+      Comparison worst_comparison;
+      for (size_t f = 0; f < result.size(); f++) {
+        const Comparison comparison = compare(reference[f], result[f]);
+        changed += comparison.max_delta > 0;
+        if (comparison.max_delta > tolerance.max_delta && comparison.psnr < tolerance.min_psnr)
+          over++;
+        if (comparison.psnr < worst_comparison.psnr) {
+          worst_comparison = comparison;
+          worst = f;
+        }
+      }
+      failed = over > 0;
+      if (changed == 0)
+        printf("identical");
+      else
+        printf("%d/%d frames changed, %d over tolerance, worst is frame %d : max delta %d, PSNR %.1f dB",
+          changed, (int)result.size(), over, worst, worst_comparison.max_delta, worst_comparison.psnr);
+      if (failed && diff_dir)
+        writeDiff(std::string(diff_dir) + "/" + program.name + ".ppm", reference_size, reference[worst], result[worst]);
+    }
+
+    if (memory_errors) {
+      printf(" | %d memory error%s, the first one %s at frame %d", memory_errors, memory_errors == 1 ? "" : "s", first_error.c_str(), first_error_frame);
+      flagged++;
+    }
+    printf("%s\n", failed ? "  FAILED" : "");
+    fflush(stdout);
+    failures += failed;
+  }
+  printf("%d program%s failed, %d with memory errors\n", failures, failures == 1 ? "" : "s", flagged);
+  return failures || flagged ? 1 : 0;
+}
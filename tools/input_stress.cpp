@@ -0,0 +1,158 @@
+// Feeds the input decoder with synthetic encoder and button edges, contact bounce included, far faster
+// than a hand can turn the knob, while another thread drains the events like the main loop does.
+// Host tool, built by CMakeLists.txt with the others : build/input_stress
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "input_events.h"
+
+static const uint32_t DEBOUNCE_US = 20000;
+static const int MOVES = 200000;
+
+// Quadrature states one step clockwise from each state (pin1 | pin2 << 1) : 3 -> 1 -> 0 -> 2 -> 3
+static const uint8_t NEXT_CW[4] = {2, 0, 3, 1};
+static const uint8_t NEXT_CCW[4] = {1, 3, 0, 2};
+
+// Stands for the pins and the interrupts : every change of level is an edge handed to the decoder
+class EdgeSource {
+  private:
+    InputDecoder &decoder;
+    uint8_t state = 3;
+    bool button_level = true;
+    uint32_t now_us = 1000;
+
+  public:
+    std::vector<InputEvent::Type> expected;
+    uint32_t edges = 0;
+
+    EdgeSource(InputDecoder &decoder) : decoder(decoder) {this->decoder.begin(3, true, 0);}
+
+    void step(bool clockwise, uint32_t edge_us, int bounces) {
+      const uint8_t next = clockwise ? NEXT_CW[this->state] : NEXT_CCW[this->state];
+      for (int i = 0; i < bounces; i++) {  // The contact chatters between the two states before settling
+        this->decoder.encoderEdge(next, this->now_us++);
+        this->decoder.encoderEdge(this->state, this->now_us++);
+        this->edges += 2;
+      }
+      this->state = next;
+      this->now_us += edge_us;
+      this->decoder.encoderEdge(next, this->now_us);
+      this->edges++;
+    }
+
+    void detent(bool clockwise, uint32_t edge_us, int bounces) {  // 2 steps per detent, TWO03
+      this->step(clockwise, edge_us, bounces);
+      this->step(clockwise, edge_us, bounces);
+      this->expected.push_back(clockwise ? InputEvent::Type::CLOCKWISE : InputEvent::Type::COUNTERCLOCKWISE);
+    }
+
+    void button(bool pressed, uint32_t bounce_us, int bounces) {
+      this->now_us += DEBOUNCE_US;
+      for (int i = 0; i < bounces; i++) {  // All within the debounce time
+        this->button_level = !this->button_level;
+        this->decoder.buttonEdge(this->button_level, this->now_us);
+        this->now_us += bounce_us;
+        this->edges++;
+      }
+      if (this->button_level != !pressed) {
+        this->button_level = !pressed;
+        this->decoder.buttonEdge(this->button_level, this->now_us);
+        this->edges++;
+      }
+      this->expected.push_back(pressed ? InputEvent::Type::BUTTON_PRESSED : InputEvent::Type::BUTTON_RELEASED);
+    }
+};
+
+// The interrupt side and the main loop side run concurrently, the queue never overflows
+static bool concurrentTest() {
+  InputDecoder decoder(EncoderLatch::TWO03, DEBOUNCE_US);
+  EdgeSource source(decoder);
+  std::atomic<uint32_t> consumed{0};
+  std::atomic<bool> done{false};
+  std::vector<InputEvent> received;
+  received.reserve(MOVES + MOVES / 50);
+
+  std::thread main_loop([&] {
+    InputEvent event;
+    while (true) {
+      const bool finished = done.load();
+      while (decoder.pop(event)) {
+        received.push_back(event);
+        consumed.fetch_add(1, std::memory_order_relaxed);
+      }
+      if (finished)
+        break;
+      std::this_thread::yield();
+    }
+  });
+  srand(1);
+  bool pressed = false;
+  for (int i = 0; i < MOVES; i++) {
+    // Stays a few events away from a full queue, as the main loop would at a human pace
+    while (source.expected.size() - consumed.load(std::memory_order_relaxed) > 48)
+      std::this_thread::yield();
+    if (rand() % 50 == 0) {
+      pressed = !pressed;
+      source.button(pressed, 300, rand() % 8);
+    } else {
+      source.detent(rand() % 3 != 0, 5 + rand() % 50, rand() % 3);
+    }
+  }
+  done = true;
+  main_loop.join();
+
+  uint32_t mismatches = 0, backwards = 0;
+  for (size_t i = 0; i < received.size() && i < source.expected.size(); i++) {
+    mismatches += received[i].type != source.expected[i];
+    backwards += i > 0 && (int32_t)(received[i].time_us - received[i - 1].time_us) < 0;
+  }
+  printf("concurrent : %u edges, %zu events expected, %zu received, %u mismatched, %u out of time order, %u dropped\n",
+    source.edges, source.expected.size(), received.size(), mismatches, backwards, decoder.droppedEvents());
+  return received.size() == source.expected.size() && mismatches == 0 && backwards == 0 && decoder.droppedEvents() == 0;
+}
+
+// Nobody drains the queue : it keeps the oldest events and counts the ones it had to drop
+static bool overflowTest() {
+  InputDecoder decoder(EncoderLatch::TWO03, DEBOUNCE_US);
+  EdgeSource source(decoder);
+  const int DETENTS = 1000;
+  for (int i = 0; i < DETENTS; i++)
+    source.detent(i % 4 != 3, 10, 1);
+  uint32_t received = 0, mismatches = 0;
+  InputEvent event;
+  while (decoder.pop(event))
+    mismatches += event.type != source.expected[received++];
+  printf("overflow   : %d events, %u kept, %u mismatched, %u dropped\n", DETENTS, received, mismatches, decoder.droppedEvents());
+  return received + decoder.droppedEvents() == DETENTS && mismatches == 0 && received == 64;
+}
+
+// Skipped states, as when edges come faster than the interrupt latency : no event without a full detent
+static bool debounceTest() {
+  InputDecoder decoder(EncoderLatch::TWO03, DEBOUNCE_US);
+  decoder.begin(3, true, 0);
+  uint32_t now = 0;
+  decoder.encoderEdge(1, now += 10);
+  decoder.encoderEdge(3, now += 10);  // Back to the detent it started from
+  decoder.encoderEdge(0, now += 10);  // 3 -> 0 is a skipped state, no direction
+  decoder.buttonEdge(false, now += 100000);
+  decoder.buttonEdge(true, now += 1000);  // Bounce, ignored
+  decoder.buttonEdge(false, now += 1000);
+  decoder.buttonEdge(true, now += 100000);
+  InputEvent event;
+  std::vector<InputEvent::Type> types;
+  while (decoder.pop(event))
+    types.push_back(event.type);
+  const bool ok = types.size() == 2 && types[0] == InputEvent::Type::BUTTON_PRESSED && types[1] == InputEvent::Type::BUTTON_RELEASED;
+  printf("debounce   : %zu events, %s\n", types.size(), ok ? "as expected" : "UNEXPECTED");
+  return ok;
+}
+
+int main() {
+  bool ok = concurrentTest();
+  ok &= overflowTest();
+  ok &= debounceTest();
+  printf(ok ? "OK\n" : "FAILED\n");
+  return ok ? 0 : 1;
+}
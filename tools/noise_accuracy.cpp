@@ -0,0 +1,104 @@
+// Accuracy of the fixed point simplex noise against the float reference, over a grid of inputs.
+// Host tool, built by CMakeLists.txt with the others : build/noise_accuracy
+#include <stdio.h>
+#include <math.h>
+#include "simplex_noise.h"
+
+struct ErrorStats {
+  const char *name;
+  double max_error = 0;
+  double sum_error = 0;
+  double sum_squared = 0;
+  long count = 0;
+  float worst_at[3] = {};
+
+  void add(float reference, float fixed, float x, float y = 0, float z = 0) {
+    double error = fabs((double)fixed - reference);
+    if (error > this->max_error) {
+      this->max_error = error;
+      this->worst_at[0] = x;
+      this->worst_at[1] = y;
+      this->worst_at[2] = z;
+    }
+    this->sum_error += error;
+    this->sum_squared += error * error;
+    this->count++;
+  }
+
+  void print() const {
+    printf("%-16s %9ld samples  max %.6f  mean %.6f  rms %.6f  (worst at %.3f, %.3f, %.3f)\n",
+      this->name, this->count, this->max_error, this->sum_error / this->count,
+      sqrt(this->sum_squared / this->count), this->worst_at[0], this->worst_at[1], this->worst_at[2]);
+  }
+};
+
+// Float reference of the 2D octave helpers
+static float octaves2dFloat(float x, float y, int octaves, float persistence = 0.5f) {
+  float noise = 0, amp = 1, max_amp = 0;
+  for (int i = 0; i < octaves; i++, amp *= persistence) {
+    noise += SimplexNoise::noiseFloat(x * (1 << i), y * (1 << i)) * amp;
+    max_amp += amp;
+  }
+  return noise / max_amp;
+}
+
+int main() {
+  ErrorStats noise1d = {"noise 1D"};
+  for (float x = -300.0f; x < 300.0f; x += 0.0037f)
+    noise1d.add(SimplexNoise::noiseFloat(x), fromQ16(SimplexNoise::noiseFixed(toQ16(x))), x);
+
+  ErrorStats noise2d = {"noise 2D"};
+  for (float y = -40.0f; y < 40.0f; y += 0.071f)
+    for (float x = -40.0f; x < 40.0f; x += 0.067f)
+      noise2d.add(SimplexNoise::noiseFloat(x, y), fromQ16(SimplexNoise::noiseFixed(toQ16(x), toQ16(y))), x, y);
+
+  ErrorStats noise3d = {"noise 3D"};
+  for (float z = -20.0f; z < 1500.0f; z += 37.3f)  // Programs use the animation time as z
+    for (float y = -12.0f; y < 12.0f; y += 0.083f)
+      for (float x = -12.0f; x < 12.0f; x += 0.079f)
+        noise3d.add(SimplexNoise::noiseFloat(x, y, z), fromQ16(SimplexNoise::noiseFixed(toQ16(x), toQ16(y), toQ16(z))), x, y, z);
+
+  // The float octave helpers go through noise(), so they are only the reference when built without the fixed point dispatch
+  ErrorStats octaves2d = {"2D, 5 octaves"};
+  ErrorStats octaves3d = {"3D, 3 octaves"};
+  ErrorStats persistent = {"2D, 8 oct., 0.9"};  // Amplitudes summing past 4
+  float reference;
+  for (float y = -8.0f; y < 8.0f; y += 0.093f) {
+    for (float x = -8.0f; x < 8.0f; x += 0.087f) {
+      persistent.add(octaves2dFloat(x, y, 8, 0.9f), fromQ16(SimplexNoise::noise2dOctavesFixed(toQ16(x), toQ16(y), 8, toQ16(0.9f))), x, y);
+      octaves2d.add(octaves2dFloat(x, y, 5), fromQ16(SimplexNoise::noise2dOctavesFixed(toQ16(x), toQ16(y), 5, toQ16(0.5f))), x, y);
+
+      float noise = 0, amp = 1, max_amp = 0;
+      for (int i = 0; i < 3; i++, amp *= 0.5f) {
+        noise += SimplexNoise::noiseFloat(x * (1 << i), y * (1 << i), 0.37f * (1 << i)) * amp;
+        max_amp += amp;
+      }
+      reference = noise / max_amp;
+      octaves3d.add(reference, fromQ16(SimplexNoise::noise3dOctavesFixed(toQ16(x), toQ16(y), toQ16(0.37f), 3, toQ16(0.5f))), x, y, 0.37f);
+    }
+  }
+
+  // Perlin fire feeds the animation time as y, through the grid kernel : its 5 octaves are past the Q16.16
+  // range once y passes 2048, 4096 s at its speed of 0.5. The float reference loses precision as y grows,
+  // so the agreement goes down with it, gradually.
+  ErrorStats late_fire[] = {{"fire, y 3000"}, {"fire, y 40000"}, {"fire, y 500000"}};
+  const float late_times[] = {3000.0f, 40000.0f, 500000.0f};
+  for (int t = 0; t < 3; t++) {
+    for (float y = late_times[t]; y < late_times[t] + 4.0f; y += 0.093f) {
+      q16_16 row[64];
+      SimplexNoise::fill2dOctavesFixed(row, 64, 1, 0, toQ48(y), toQ16(0.087f), 0, 5, toQ16(0.5f));
+      for (int x = 0; x < 64; x++)
+        late_fire[t].add(octaves2dFloat(fromQ16(x * toQ16(0.087f)), y, 5), fromQ16(row[x]), x * 0.087f, y);
+    }
+  }
+
+  noise1d.print();
+  noise2d.print();
+  noise3d.print();
+  octaves2d.print();
+  octaves3d.print();
+  persistent.print();
+  for (const ErrorStats &late : late_fire)
+    late.print();
+  return 0;
+}
@@ -0,0 +1,62 @@
+// Cost and accuracy of the plasma noise field cache, against evaluating the field every frame.
+// Host tool, built by CMakeLists.txt with the others : build/noise_field_cache_bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "noise_field_cache.h"
+
+static const float FRAMERATE = 31;
+static const float SPEED = 0.125f;  // Default speed of the plasma programs
+static const float SCALE = 15;
+static const float INTERVAL = 0.05f;  // Same as PLASMA_KEYFRAME_INTERVAL
+static const int BUILD_FRAMES = 10;
+static const int FRAMES = 2000;
+
+static uint8_t paletteIndex(q16_16 noise) {return std::min(std::max(((noise + Q16_ONE) >> 1) * 255 >> 16, 0), 255);}
+
+int main() {
+  printf("size    direct: samples/frame us/frame   cached: samples/frame us/frame   error (0-255 palette index): max mean\n");
+  for (int size : {16, 32, 64, 128}) {
+    NoiseFieldCache direct(SCALE, 0, 1);
+    NoiseFieldCache cached(SCALE, INTERVAL, BUILD_FRAMES);
+    NoiseFieldCache reference(SCALE, 0, 1);  // Field at the cache's display time, which lags by one interval
+    std::vector<q16_16> a(size), b(size);
+    double direct_us = 0, cached_us = 0, error_sum = 0;
+    int max_error = 0;
+    float t0 = 1000;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+      const float t = t0 + frame / FRAMERATE * SPEED;
+      auto start = std::chrono::steady_clock::now();
+      direct.update(size, size, t);
+      for (int y = 0; y < size; y++)
+        direct.row(y, a.data());
+      auto middle = std::chrono::steady_clock::now();
+      cached.update(size, size, t);
+      for (int y = 0; y < size; y++)
+        cached.row(y, a.data());
+      auto end = std::chrono::steady_clock::now();
+      direct_us += std::chrono::duration<double, std::micro>(middle - start).count();
+      cached_us += std::chrono::duration<double, std::micro>(end - middle).count();
+
+      reference.update(size, size, t - INTERVAL);
+      for (int y = 0; y < size; y++) {
+        cached.row(y, a.data());
+        reference.row(y, b.data());
+        for (int x = 0; x < size; x++) {
+          int error = abs(paletteIndex(a[x]) - paletteIndex(b[x]));
+          max_error = std::max(max_error, error);
+          error_sum += error;
+        }
+      }
+    }
+
+    printf("%3dx%-3d %21.0f %8.1f %23.0f %8.1f %30d %.3f\n", size, size,
+      (double)direct.stats().samples_evaluated / FRAMES, direct_us / FRAMES,
+      (double)cached.stats().samples_evaluated / FRAMES, cached_us / FRAMES,
+      max_error, error_sum / FRAMES / (size * size));
+    printf("        cached: %u keyframes, %u catch-ups, %u resets\n", cached.stats().keyframes, cached.stats().catch_ups, cached.stats().resets);
+  }
+  return 0;
+}
@@ -0,0 +1,189 @@
+// Frame time of every program, at panel sizes from 16x16 to 128x128 : each program is built and run for
+// a few thousand iterate() calls, with the same seed and the same animation times on every run, and the
+// median and 99th percentile of the time per frame (and per pixel) are reported, with the RAM it takes.
+// The results can be written as CSV or JSON, and compared against a CSV written earlier : a median more
+// than --threshold percent slower than in the baseline is a regression, and makes the exit status 1.
+// Host tool, built by CMakeLists.txt with the others : build/program_bench
+//   build/program_bench --csv baseline.csv
+//   build/program_bench --baseline baseline.csv
+// Timings are the host's, they only compare programs, sizes and builds with each other. The Pico is
+// roughly 50 to 100 times slower, more for float heavy programs as it has no FPU.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "program_registry.h"
+
+static const float FRAMERATE = 31;  // Same as main.ino
+static const uint32_t SEED = 1;
+static const int WARMUP_FRAMES = 50;  // Lets the simulations fill their maps before timing
+
+struct Result {
+  std::string program;
+  int width, height;
+  int frames;
+  double median_ns, p99_ns, mean_ns;
+  uint32_t ram_bytes;  // Its object and what it allocated, see ProgramArena::ramBytes()
+  double medianPerPixel() const {return this->median_ns / (this->width * this->height);}
+  double p99PerPixel() const {return this->p99_ns / (this->width * this->height);}
+};
+
+static Result run(uint8_t index, int size, int frames) {
+  static ProgramArena arena;
+  Canvas canvas(size, size);
+  std::vector<double> times(frames);  // Allocated before the program is built, not to be counted in its RAM
+  srand(SEED);  // Programs draw from rand() as soon as they are built
+  WS2812MatrixProgram *program = arena.load(index, size, size);
+  for (int frame = -WARMUP_FRAMES; frame < frames; frame++) {
+    const float time = (frame + WARMUP_FRAMES) / FRAMERATE;
+    const auto start = std::chrono::steady_clock::now();
+    program->iterate(canvas, time);
+    const auto end = std::chrono::steady_clock::now();
+    if (frame >= 0)
+      times[frame] = std::chrono::duration<double, std::nano>(end - start).count();
+  }
+  Result result = {ProgramRegistry::get(index).name, size, size, frames};
+  result.ram_bytes = arena.ramBytes();
+  arena.unload();
+  double sum = 0;
+  for (double t : times)
+    sum += t;
+  result.mean_ns = sum / frames;
+  std::sort(times.begin(), times.end());
+  result.median_ns = times[frames / 2];
+  result.p99_ns = times[std::min(frames - 1, (int)(frames * 0.99))];
+  return result;
+}
+
+static void writeCsv(FILE *out, const std::vector<Result> &results) {
+  fprintf(out, "program,width,height,frames,median_ns,p99_ns,mean_ns,median_ns_per_pixel,p99_ns_per_pixel,ram_bytes\n");
+  for (const Result &r : results)
+    fprintf(out, "%s,%d,%d,%d,%.0f,%.0f,%.0f,%.2f,%.2f,%u\n", r.program.c_str(), r.width, r.height, r.frames,
+      r.median_ns, r.p99_ns, r.mean_ns, r.medianPerPixel(), r.p99PerPixel(), r.ram_bytes);
+}
+
+static void writeJson(FILE *out, const std::vector<Result> &results) {
+  fprintf(out, "{\"seed\": %u, \"framerate\": %.0f, \"results\": [\n", SEED, FRAMERATE);
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    fprintf(out, "  {\"program\": \"%s\", \"width\": %d, \"height\": %d, \"frames\": %d, \"median_ns\": %.0f, \"p99_ns\": %.0f, "
+      "\"mean_ns\": %.0f, \"median_ns_per_pixel\": %.2f, \"p99_ns_per_pixel\": %.2f, \"ram_bytes\": %u}%s\n", r.program.c_str(), r.width,
+      r.height, r.frames, r.median_ns, r.p99_ns, r.mean_ns, r.medianPerPixel(), r.p99PerPixel(), r.ram_bytes, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(out, "]}\n");
+}
+
+static bool readCsv(const char *path, std::vector<Result> &results) {
+  FILE *in = fopen(path, "r");
+  if (!in)
+    return false;
+  char line[256], name[64];
+  fgets(line, sizeof(line), in);  // Header
+  while (fgets(line, sizeof(line), in)) {
+    Result r;
+    if (sscanf(line, "%63[^,],%d,%d,%d,%lf,%lf,%lf", name, &r.width, &r.height, &r.frames, &r.median_ns, &r.p99_ns, &r.mean_ns) == 7) {
+      r.program = name;
+      results.push_back(r);
+    }
+  }
+  fclose(in);
+  return true;
+}
+
+static FILE *openOutput(const char *path) {
+  FILE *out = fopen(path, "w");
+  if (!out)
+    perror(path);
+  return out;
+}
+
+int main(int argc, char **argv) {
+  int frames = 2000;
+  std::vector<int> sizes = {16, 32, 64, 128};
+  const char *csv_path = nullptr, *json_path = nullptr, *baseline_path = nullptr, *only = nullptr;
+  double threshold = 10;  // Percents
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--frames") == 0) {
+      frames = std::max(1, atoi(argv[i + 1]));
+    }
+    else if (strcmp(argv[i], "--sizes") == 0) {  // Comma separated, square panels
+      sizes.clear();
+      for (char *size = strtok(argv[i + 1], ","); size; size = strtok(nullptr, ","))
+        sizes.push_back(std::max(1, atoi(size)));
+    }
+    else if (strcmp(argv[i], "--program") == 0) {
+      only = argv[i + 1];
+    }
+    else if (strcmp(argv[i], "--csv") == 0) {
+      csv_path = argv[i + 1];
+    }
+    else if (strcmp(argv[i], "--json") == 0) {
+      json_path = argv[i + 1];
+    }
+    else if (strcmp(argv[i], "--baseline") == 0) {
+      baseline_path = argv[i + 1];
+    }
+    else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[i + 1]);
+    }
+    else {
+      break;
+    }
+  }
+  if (argc % 2 == 0) {
+    fprintf(stderr, "Usage : %s [--frames N] [--sizes 16,32,64,128] [--program NAME] [--csv FILE] [--json FILE] "
+      "[--baseline FILE] [--threshold PERCENT]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<Result> baseline;
+  if (baseline_path && !readCsv(baseline_path, baseline)) {
+    perror(baseline_path);
+    return 1;
+  }
+
+  std::vector<Result> results;
+  int regressions = 0;
+  printf("%-22s %7s %12s %12s %10s %10s %9s %s\n", "program", "size", "median ns", "p99 ns", "ns/pixel", "p99/pixel", "RAM", baseline_path ? "  vs baseline" : "");
+  for (int size : sizes) {
+    for (uint8_t index = 0; index < ProgramRegistry::size(); index++) {
+      if (only && strcmp(only, ProgramRegistry::get(index).name) != 0)
+        continue;
+      const Result r = run(index, size, frames);
+      results.push_back(r);
+      printf("%-22s %3dx%-3d %12.0f %12.0f %10.2f %10.2f %9u", r.program.c_str(), r.width, r.height, r.median_ns, r.p99_ns, r.medianPerPixel(),
+        r.p99PerPixel(), r.ram_bytes);
+      for (const Result &b : baseline) {
+        if (b.program == r.program && b.width == r.width && b.height == r.height) {
+          const double change = (r.median_ns / b.median_ns - 1) * 100;
+          const bool regression = change > threshold;
+          regressions += regression;
+          printf("  %+7.1f%%%s", change, regression ? "  REGRESSION" : "");
+        }
+      }
+      printf("\n");
+      fflush(stdout);
+    }
+  }
+
+  if (csv_path) {
+    FILE *out = openOutput(csv_path);
+    if (!out)
+      return 1;
+    writeCsv(out, results);
+    fclose(out);
+  }
+  if (json_path) {
+    FILE *out = openOutput(json_path);
+    if (!out)
+      return 1;
+    writeJson(out, results);
+    fclose(out);
+  }
+  if (baseline_path)
+    printf("%d regression%s over %.0f%%\n", regressions, regressions == 1 ? "" : "s", threshold);
+  return regressions ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+// Stress test of the lock-free handoff between the rendering and the sending core, with two std::threads
+// standing in for the two cores of the RP2040.
+// Host tool, built by CMakeLists.txt with the others : build/spsc_stress
+// Building with -DCMAKE_CXX_FLAGS=-fsanitize=thread also checks the memory ordering of SpscRing.
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include "spsc_ring.h"
+#include "frame_pipeline.h"
+
+static const uint32_t ITEMS = 20000000;
+static const uint32_t FRAMES = 200000;
+static const int FRAME_BYTES = 16 * 16 * 3;
+
+// Every item goes through in order, none lost or duplicated, whichever side is faster
+static bool ringTest() {
+  static SpscRing<uint32_t, 64> ring;
+  uint32_t errors = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::thread producer([] {
+    for (uint32_t i = 0; i < ITEMS; i++)
+      while (!ring.push(i))
+        std::this_thread::yield();
+  });
+  std::thread consumer([&errors] {
+    uint32_t item;
+    for (uint32_t expected = 0; expected < ITEMS; expected++) {
+      while (!ring.pop(item))
+        std::this_thread::yield();
+      errors += item != expected;
+    }
+  });
+  producer.join();
+  consumer.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("SpscRing<uint32_t, 64> : %u items, %u out of order, %.1f M items/s\n", ITEMS, errors, ITEMS / seconds / 1e6);
+  return errors == 0 && ring.empty();
+}
+
+// Frames are filled with their sequence number : a frame seen while the renderer still writes it, or
+// a buffer handed to the renderer while it's being sent, shows up as mixed bytes.
+template <uint8_t N>
+static bool pipelineTest() {
+  static uint8_t buffers[N][FRAME_BYTES];
+  static FramePipeline<N> pipeline;
+  uint32_t torn = 0, out_of_order = 0, renderer_stalls = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::thread renderer([&renderer_stalls] {
+    uint8_t f;
+    for (uint32_t frame = 0; frame < FRAMES; frame++) {
+      while (!pipeline.acquire(f)) {
+        renderer_stalls++;
+        std::this_thread::yield();
+      }
+      for (int i = 0; i < FRAME_BYTES; i++)  // Byte by byte, so that a concurrent reader would see it happen
+        ((volatile uint8_t *)buffers[f])[i] = (uint8_t)frame;
+      memcpy(buffers[f], &frame, sizeof(frame));
+      pipeline.publish(f);
+    }
+  });
+  std::thread sender([&torn, &out_of_order] {
+    uint8_t f;
+    uint8_t wire[FRAME_BYTES];
+    for (uint32_t expected = 0; expected < FRAMES; expected++) {
+      while (!pipeline.receive(f))
+        std::this_thread::yield();
+      memcpy(wire, buffers[f], FRAME_BYTES);
+      pipeline.release(f);
+      uint32_t frame;
+      memcpy(&frame, wire, sizeof(frame));
+      out_of_order += frame != expected;
+      for (int i = sizeof(frame); i < FRAME_BYTES; i++)
+        if (wire[i] != (uint8_t)frame) {
+          torn++;
+          break;
+        }
+    }
+  });
+  renderer.join();
+  sender.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("FramePipeline<%d> : %u frames, %u torn, %u out of order, %u renderer stalls, %.0f k frames/s\n",
+    N, FRAMES, torn, out_of_order, renderer_stalls, FRAMES / seconds / 1e3);
+  return torn == 0 && out_of_order == 0 && pipeline.queued() == 0;
+}
+
+int main() {
+  bool ok = ringTest();
+  ok &= pipelineTest<2>();
+  ok &= pipelineTest<3>();
+  printf(ok ? "OK\n" : "FAILED\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+// Reads the binary telemetry of the sketch (see telemetry.h) back : prints the records as text, and can
+// write the frame stats as CSV, the snapshots as PPM images and plot the frame times in the terminal.
+// Records that don't check out are counted and skipped, the reading picks up at the next one.
+// Host tool, built by CMakeLists.txt with the others : build/telemetry_decode
+//   stty -F /dev/ttyACM0 raw && build/telemetry_decode /dev/ttyACM0
+//   build/firmware_host --threads --serial --output /dev/null 2> telemetry.bin
+//   build/telemetry_decode telemetry.bin --csv stats.csv --snapshots snapshots --plot
+// On the serial port, 's' asks for a snapshot of the next frame, and 'p' for the frame profile when the
+// profiler is built in.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "program_registry.h"
+#include "telemetry.h"
+
+struct PayloadReader {
+  const uint8_t *data;
+  size_t left;
+  bool ok = true;
+
+  PayloadReader(const uint8_t *data, size_t length) : data(data), left(length) {};
+  uint8_t get8() {
+    if (!this->left) {
+      this->ok = false;
+      return 0;
+    }
+    this->left--;
+    return *this->data++;
+  }
+  uint16_t get16() {const uint16_t low = this->get8(); return low | this->get8() << 8;}
+  uint32_t get32() {const uint32_t low = this->get16(); return low | (uint32_t)this->get16() << 16;}
+};
+
+struct Counts {
+  uint32_t records = 0;
+  uint32_t corrupt = 0;  // Bad COBS encoding, CRC or payload length
+  uint32_t other_versions = 0;
+  uint32_t lost = 0;  // Gaps in the sequence numbers
+};
+
+struct Options {
+  FILE *csv = nullptr;
+  const char *snapshots = nullptr;  // Directory
+  bool plot = false;
+};
+
+static std::vector<float> render_ms, frame_ms;  // Of every frame stats record, for --plot
+
+static bool decodeStats(PayloadReader &in, uint16_t sequence, const Options &options) {
+  Telemetry::FrameStats stats;
+  stats.frames = in.get32();
+  stats.render_us = in.get32();
+  const uint32_t max_render_us = in.get32();
+  stats.period_us = in.get32();
+  stats.current_ma = in.get16();
+  stats.power_mw = in.get16();
+  stats.brightness = in.get16();
+  stats.late_frames = in.get32();
+  stats.dropped_frames = in.get32();
+  stats.program = in.get8();
+  stats.flags = in.get8();
+  stats.program_ram = in.get32();
+  if (!in.ok || in.left)
+    return false;
+
+  const float fps = stats.period_us ? 1e6f / stats.period_us : 0;  // The program names are those of this build, the knob ones first as on the Pico
+  printf("frame %6u | %.3f A | %.2f W | render %6.2f ms (max %6.2f) | %5.1f fps | late %u | dropped %u | brightness %.3f | "
+    "program %2u %s (%.1f kB) | %s\n", stats.frames, stats.current_ma / 1000.0, stats.power_mw / 1000.0, stats.render_us / 1000.0,
+    max_render_us / 1000.0, fps, stats.late_frames, stats.dropped_frames, stats.brightness / 1000.0, stats.program,
+    stats.program < ProgramRegistry::knobSize() ? ProgramRegistry::get(stats.program).name : "?", stats.program_ram / 1024.0,
+    stats.flags & Telemetry::SELECTING_PROGRAM ? "program selection" : "brightness selection");
+  if (options.csv)
+    fprintf(options.csv, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", sequence, stats.frames, stats.render_us, max_render_us,
+      stats.period_us, stats.current_ma, stats.power_mw, stats.brightness, stats.late_frames, stats.dropped_frames,
+      stats.program, stats.flags, stats.program_ram);
+  render_ms.push_back(max_render_us / 1000.0f);
+  frame_ms.push_back(stats.period_us / 1000.0f);
+  return true;
+}
+
+static bool decodeProfile(PayloadReader &in) {
+  const uint8_t stage = in.get8();
+  std::string name(in.get8(), ' ');
+  for (char &c : name)
+    c = in.get8();
+  const uint32_t count = in.get32();
+  const uint32_t max_us = in.get32();
+  uint64_t total_us = in.get32();
+  total_us |= (uint64_t)in.get32() << 32;
+  std::vector<uint32_t> histogram(in.get8());
+  for (uint32_t &bucket : histogram)
+    bucket = in.get32();
+  if (!in.ok || in.left)
+    return false;
+
+  printf("profile %2u %-12s %7u frames | mean %7llu us | max %7u us |", stage, name.c_str(), count,
+    (unsigned long long)(count ? total_us / count : 0), max_us);
+  for (size_t b = 0; b < histogram.size(); b++)  // Bucket b holds the times under 2^b us
+    if (histogram[b])
+      printf(" <%lluus:%u", 1ull << b, histogram[b]);
+  printf("\n");
+  return true;
+}
+
+static bool decodeSnapshot(PayloadReader &in, uint16_t sequence, const Options &options) {
+  const uint8_t width = in.get8(), height = in.get8(), factor = in.get8();
+  if (!in.ok || in.left != (size_t)width * height * 3)
+    return false;
+
+  printf("snapshot %ux%u, 1/%u of the canvas", width, height, factor);
+  if (options.snapshots) {
+    const std::string path = std::string(options.snapshots) + "/snapshot_" + std::to_string(sequence) + ".ppm";
+    FILE *out = fopen(path.c_str(), "wb");
+    if (out) {
+      fprintf(out, "P6\n%u %u\n255\n", width, height);
+      fwrite(in.data, 1, in.left, out);
+      fclose(out);
+      printf(" : %s", path.c_str());
+    }
+    else {
+      perror(path.c_str());
+    }
+  }
+  printf("\n");
+  return true;
+}
+
+// The first record read may have lost its beginning, it isn't counted as corrupt
+static void decodeRecord(const uint8_t *encoded, size_t length, bool first, Counts &counts, const Options &options) {
+  static uint8_t record[Telemetry::MAX_ENCODED];
+  static bool has_sequence = false;
+  static uint16_t last_sequence;
+
+  const size_t record_length = length <= sizeof(record) ? cobsDecode(encoded, length, record) : 0;
+  if (record_length < 6 || telemetryCrc16(record, record_length - 2) != (record[record_length - 2] | record[record_length - 1] << 8)) {
+    counts.corrupt += !first;
+    return;
+  }
+  if (record[0] != Telemetry::VERSION) {
+    counts.other_versions++;
+    return;
+  }
+  const uint16_t sequence = record[2] | record[3] << 8;
+  if (has_sequence)
+    counts.lost += (uint16_t)(sequence - last_sequence - 1);
+  has_sequence = true;
+  last_sequence = sequence;
+
+  PayloadReader in(record + 4, record_length - 6);
+  bool ok;
+  switch ((Telemetry::Record)record[1]) {
+    case Telemetry::Record::FRAME_STATS:
+      ok = decodeStats(in, sequence, options);
+      break;
+    case Telemetry::Record::PROFILE:
+      ok = decodeProfile(in);
+      break;
+    case Telemetry::Record::SNAPSHOT:
+      ok = decodeSnapshot(in, sequence, options);
+      break;
+    default:
+      ok = false;
+      break;
+  }
+  if (ok)
+    counts.records++;
+  else
+    counts.corrupt++;
+}
+
+// Columns of the maximum of the values they cover, over as many rows
+static void plot(const char *title, const std::vector<float> &values) {
+  const int WIDTH = 72, HEIGHT = 12;
+  if (values.empty())
+    return;
+  const int columns = std::min<int>(WIDTH, values.size());
+  std::vector<float> column(columns, 0);
+  for (size_t i = 0; i < values.size(); i++)
+    column[i * columns / values.size()] = std::max(column[i * columns / values.size()], values[i]);
+  const float top = std::max(*std::max_element(column.begin(), column.end()), 1e-3f);
+  printf("\n%s, %zu records\n", title, values.size());
+  for (int row = HEIGHT; row > 0; row--) {
+    printf("%8.2f |", top * row / HEIGHT);
+    for (int x = 0; x < columns; x++)
+      putchar(column[x] * HEIGHT >= top * (row - 0.5f) ? '#' : ' ');
+    putchar('\n');
+  }
+  printf("%8s +%s\n", "ms", std::string(columns, '-').c_str());
+}
+
+int main(int argc, char **argv) {
+  const char *path = "-";
+  const char *csv_path = nullptr;
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+      csv_path = argv[++i];
+    }
+    else if (strcmp(argv[i], "--snapshots") == 0 && i + 1 < argc) {
+      options.snapshots = argv[++i];
+    }
+    else if (strcmp(argv[i], "--plot") == 0) {
+      options.plot = true;
+    }
+    else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+      path = argv[i];
+    }
+    else {
+      fprintf(stderr, "Usage : %s [FILE, - for stdin] [--csv FILE] [--snapshots DIR] [--plot]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+  if (csv_path) {
+    options.csv = fopen(csv_path, "w");
+    if (!options.csv) {
+      perror(csv_path);
+      return 1;
+    }
+    fprintf(options.csv, "sequence,frames,render_us,max_render_us,period_us,current_ma,power_mw,brightness,late_frames,dropped_frames,program,flags,program_ram\n");
+  }
+
+  Counts counts;
+  std::vector<uint8_t> encoded;
+  bool first = true;
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    if (c) {
+      encoded.push_back(c);
+      continue;
+    }
+    if (!encoded.empty())
+      decodeRecord(encoded.data(), encoded.size(), first, counts, options);
+    first = false;
+    encoded.clear();
+    fflush(stdout);
+  }
+
+  if (options.plot) {
+    plot("Longest render time between records", render_ms);
+    plot("Frame period", frame_ms);
+  }
+  fprintf(stderr, "%u records, %u corrupt, %u of another version, %u lost\n", counts.records, counts.corrupt, counts.other_versions, counts.lost);
+  if (options.csv)
+    fclose(options.csv);
+  if (in != stdin)
+    fclose(in);
+  return 0;
+}
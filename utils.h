@@ -1,29 +1,34 @@
 #ifndef UTILS_H
 #define UTILS_H
 #include <Arduino.h>
-#include <Adafruit_NeoMatrix.h>
+#include <vector>
+#include "canvas.h"
 
 uint16_t ColorHSV(uint16_t hue, uint8_t sat, uint8_t val);
-float matrixCurrentDraw(Adafruit_NeoMatrix &matrix, float current_per_channel);
-float matrixPowerDraw(Adafruit_NeoMatrix &matrix, float current_per_channel, float voltage);
-void matrixApplyBrightness(Adafruit_NeoMatrix &matrix, float brightness);
+uint32_t ColorHSV888(uint16_t hue, uint8_t sat, uint8_t val);  // Same as ColorHSV, without the quantization to RGB565
+// Converts n pixels at once, through a table of the 1530 hues. sat and/or val can be NULL for 255 (fully saturated/bright).
+// Bit-exact with ColorHSV888, and ColorHSVBatch565 with ColorHSV.
+void ColorHSVBatch(const uint16_t *hue, const uint8_t *sat, const uint8_t *val, uint32_t *out, uint16_t n);
+void ColorHSVBatch565(const uint16_t *hue, const uint8_t *sat, const uint8_t *val, uint16_t *out, uint16_t n);
+void ColorHSVValues(uint16_t hue, uint8_t sat, const uint8_t *val, uint32_t *out, uint16_t n);  // Single hue, varying value
+
+struct HSVRow {  // Scratch row that programs fill before converting it in one batch
+  std::vector<uint16_t> hue;
+  std::vector<uint8_t> sat, val;
+  void reserve(uint16_t n) {  // Only allocates the first time, or if the canvas grows
+    if (this->hue.size() < n) {
+      this->hue.resize(n);
+      this->sat.resize(n);
+      this->val.resize(n);
+    }
+  }
+};
+
 uint32_t color565To888(uint16_t color565);
 uint16_t color888To565(uint32_t color888);
 uint16_t interpolateColors565(uint16_t col1, uint16_t col2, float frac); // Interpolates between 2 16 bits colors
-void fadeToBlack(Adafruit_NeoMatrix &matrix, float fade_factor);
-void drawLine(Adafruit_NeoMatrix &matrix, float x1, float y1, float x2, float y2, uint16_t hue, uint8_t sat, uint8_t val, bool grad, uint8_t resolution);
-
-class GaussianBlur {
-  private:
-    static const int kernel_h = 3;
-    static const int kernel_w = 3;
-    uint kernel[kernel_h][kernel_w] = {0, 0, 0, 0 ,0, 0, 0, 0, 0};
-    uint kernel_sum = 0;
-  public:
-    GaussianBlur(float sigma);
-    uint k(int i, int j) {return this->kernel[i][j];}
-    uint norm() {return this->kernel_sum;}
-    void blur(Adafruit_NeoMatrix &matrix);
-};
+uint32_t interpolateColors888(uint32_t col1, uint32_t col2, float frac); // Interpolates between 2 24 bits colors
+void fadeToBlack(Canvas &canvas, float fade_factor);
+void drawLine(Canvas &canvas, float x1, float y1, float x2, float y2, uint16_t hue, uint8_t sat, uint8_t val, bool grad, uint8_t resolution);
 
 #endif
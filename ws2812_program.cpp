@@ -1,14 +1,14 @@
 #include <math.h>
 #include <algorithm>
-#include <Adafruit_NeoMatrix.h>
 #include <stdlib.h>
 #include "ws2812_program.h"
 #include "utils.h"
 #include "simplex_noise.h"
+#include "fast_math.h"
 
-void SpectralProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  matrix.fillScreen(
-    ColorHSV(
+void SpectralProgram::iterate(Canvas &canvas, float time) {
+  canvas.fill(
+    ColorHSV888(
       uint16_t(fmod(time * this->speed, 1.0) * 65536),
       255,
       255
@@ -16,179 +16,141 @@ void SpectralProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
     );
 }
 
-void RainbowWaveProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  for (int x = 0; x < matrix.width(); x++) {
-    float val = this->n_waves * (fmod(time * this->speed, 1.0) + x / float(matrix.width()));
-    for (int y = 0; y < matrix.height(); y++) {
-      matrix.drawPixel(x, y, ColorHSV(uint16_t(val * 65536), 255, 255));
-    }
+void RainbowWaveProgram::iterate(Canvas &canvas, float time) {
+  this->hsv_row.reserve(canvas.width());
+  for (int x = 0; x < canvas.width(); x++) {
+    float val = this->n_waves * (fmod(time * this->speed, 1.0) + x / float(canvas.width()));
+    this->hsv_row.hue[x] = uint16_t(val * 65536);
+  }
+  ColorHSVBatch(this->hsv_row.hue.data(), NULL, NULL, canvas.row(0), canvas.width());
+  for (int y = 1; y < canvas.height(); y++) {  // Every row is the same
+    std::copy(canvas.row(0), canvas.row(0) + canvas.width(), canvas.row(y));
   }
 }
 
-void RainbowPlasmaProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  float hue;
+void RainbowPlasmaProgram::iterate(Canvas &canvas, float time) {
+  q16_16 hue;
   float hue_shift = time * this->speed * 0.05f + 1;
   hue_shift += SimplexNoise::noise(time * this->speed * 0.2f);
   hue_shift = fmod(hue_shift, 1.0);
-  for (int x = 0; x < matrix.width(); x++) {
-    for (int y = 0; y < matrix.height(); y++) {
-      hue = (SimplexNoise::noise(x/this->scale, y/this->scale + time * this->speed, time * this->speed) + 1.0) / 2.0;
-      hue = fmod(hue + hue_shift, 1.0); // Simplex noise is centered on 0, so we can do this to have a continuously changing mean value
-      matrix.drawPixel(x, y, ColorHSV(uint16_t(hue * 65536), 255, 255));
+  const uint16_t shift = uint16_t(hue_shift * 65536);
+  this->hsv_row.reserve(canvas.width());
+  this->noise_row.resize(canvas.width());
+  this->noise_field.update(canvas.width(), canvas.height(), time * this->speed);
+  for (int y = 0; y < canvas.height(); y++) {
+    this->noise_field.row(y, this->noise_row.data());
+    for (int x = 0; x < canvas.width(); x++) {
+      hue = (this->noise_row[x] + Q16_ONE) >> 1;
+      this->hsv_row.hue[x] = uint16_t(hue + shift); // Simplex noise is centered on 0, so we can do this to have a continuously changing mean value
     }
+    ColorHSVBatch(this->hsv_row.hue.data(), NULL, NULL, canvas.row(y), canvas.width());
   }
 }
 
-void FirePlasmaProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  uint16_t color565;
-  float hue;
-  for (int x = 0; x < matrix.width(); x++) {
-    for (int y = 0; y < matrix.height(); y++) {
-      hue = (SimplexNoise::noise(x/this->scale, y/this->scale + time * this->speed, time * this->speed) + 1.0) / 2.0;
+void FirePlasmaProgram::iterate(Canvas &canvas, float time) {
+  q16_16 hue;
+  uint32_t *row;
+  this->noise_row.resize(canvas.width());
+  this->noise_field.update(canvas.width(), canvas.height(), time * this->speed);
+  for (int y = 0; y < canvas.height(); y++) {
+    row = canvas.row(y);
+    this->noise_field.row(y, this->noise_row.data());
+    for (int x = 0; x < canvas.width(); x++) {
+      hue = (this->noise_row[x] + Q16_ONE) >> 1;
       //hue *= hue;
-      color565 = this->COLOR_PALETTE_565[(int)round(36 * hue)];
-      matrix.drawPixel(x, y, color565);
+      row[x] = FIRE_PALETTE[Palette::indexFixed(hue)];
     }
   }
 }
 
-void SpectralFirePlasmaProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  uint32_t color_hsv;
-  uint8_t h, s, v;
-  float value;
-  for (int x = 0; x < matrix.width(); x++) {
-    for (int y = 0; y < matrix.height(); y++) {
-      value = (SimplexNoise::noise(x/this->scale, y/this->scale + time * this->speed, time * this->speed) + 1.0) / 2.0;
+void SpectralFirePlasmaProgram::iterate(Canvas &canvas, float time) {
+  q16_16 value;
+  uint32_t *row;
+  this->palette.rotate(uint16_t(fmod(time * .03 * this->speed, 1.0) * 65536));  // The whole palette slowly goes around the color wheel
+  this->noise_row.resize(canvas.width());
+  this->noise_field.update(canvas.width(), canvas.height(), time * this->speed);
+  for (int y = 0; y < canvas.height(); y++) {
+    row = canvas.row(y);
+    this->noise_field.row(y, this->noise_row.data());
+    for (int x = 0; x < canvas.width(); x++) {
+      value = (this->noise_row[x] + Q16_ONE) >> 1;
       //value *= value;
-      color_hsv = this->COLOR_PALETTE_HSV[(int)round(36 * value)];
-      h = ((color_hsv >> 16) & 0x0000ff);
-      s = ((color_hsv >> 8) & 0x0000ff);
-      v = (color_hsv & 0x0000ff);
-      h = (uint8_t)((h/255.0 + time * .03 * this->speed) * 255) % 255;
-      matrix.drawPixel(x, y, ColorHSV(uint16_t(h * 255), s, v));
+      row[x] = this->palette[Palette::indexFixed(value)];
     }
   }
 }
 /*
 ###################################################################################################
 
-Perlin Fire
+Simulation programs
 
 ###################################################################################################
 */
-void PerlinFireProgram::createFireSource(){
-  for (int x = 0; x < this->heat_map.width(); x++) {
-    this->heat_map.value_map[this->heat_map.height()-1] = std::vector<float>(this->heat_map.width(), 1.0);
-    }
-}
-
-void PerlinFireProgram::applyConvection() {
-  
-  for (int y = 1; y < this->heat_map.height(); y++) {
-    this->heat_map.value_map[y-1] = this->heat_map.value_map[y];
-    }
-}
-
-void PerlinFireProgram::updateCoolingMap(float offset) {
-  for (int i = 1; i < this->cooling_map.height(); i++) {
-    this->cooling_map.value_map[i - 1] = this->cooling_map.value_map[i];
-    }
-
-  for (int j = 0; j < this->cooling_map.width(); j++) {
-    this->cooling_map.value_map[this->cooling_map.height() - 1][j] = (
-      SimplexNoise::noise2dOctaves(
-        j / this->noise_scale,
-        this->cooling_map.height() / this->noise_scale + offset,
-        this->octaves,
-        0.5f
-        ) + 1.0) / 2.0;
-    }
-}
-
-void PerlinFireProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  float periodicity = 1.0f / this->speed;
-  if (this->cycles >= periodicity || this->cycles == 0) {  // Update the heat map
-    this->applyConvection();  // Maybe act here to reduce speed
-    this->createFireSource();
-    this->updateCoolingMap(time * this->speed);
-
-    for (int y = 0; y < this->h; y++){ // First, we store heat map
-        for (int x = 0; x < this->w; x++){
-          this->heat_map_prev.value_map[y][x] = this->heat_map.value_map[y][x];
-        }
-      }
-    for (int y = 0; y < this->h; y++){ // Then we update it
-      for (int x = 0; x < this->w; x++){
-        this->heat_map.value_map[y][x] -= this->cooling_map.value_map[y][x] / this->flame_height;
-        this->heat_map.value_map[y][x] = max(0, this->heat_map.value_map[y][x]);
-      }
+void SimulationProgram::iterate(Canvas &canvas, float time) {
+  if (!this->started) {  // The first step is taken on the first frame
+    this->next_tick = time;
+    this->started = true;
+  }
+  uint8_t steps = 0;
+  while (time >= this->next_tick) {
+    if (steps++ == MAX_STEPS_PER_FRAME) {  // The steps missed are dropped
+      this->next_tick = time + this->tick;
+      break;
     }
-
-    this->cycles = 0;
+    this->step(this->next_tick);
+    this->next_tick += this->tick;
   }
-
-  float alpha = this->cycles / periodicity;
-  float heat_val;
-  uint16_t color565;
-  for (int y = 0; y < this->h; y++){
-    for (int x = 0; x < this->w; x++){
-      heat_val = (0.5f * this->heat_map_prev.value_map[y][x] + 0.5f * this->heat_map.value_map[y][x]);
-      color565 = this->COLOR_PALETTE_565[(int)round(36 * heat_val)];
-      matrix.drawPixel(x, y, color565);
-    }
-  }
-
-  this->cycles += 1;
+  const float alpha = 1 - (this->next_tick - time) / this->tick;
+  this->render(canvas, min(1.0f, max(0.0f, alpha)), time);
 }
 
-
 /*
 ###################################################################################################
 
-Spectral Perlin Fire
+Perlin Fire
 
 ###################################################################################################
 */
-
-void SpectralPerlinFireProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  float periodicity = 1.0f / this->speed;
-  if (this->cycles >= periodicity || this->cycles == 0) {  // Update the heat map
-    this->applyConvection();  // Maybe act here to reduce speed
-    this->createFireSource();
-    this->updateCoolingMap(time * this->speed);
-
-    for (int y = 0; y < this->h; y++){ // First, we store heat map
-        for (int x = 0; x < this->w; x++){
-          this->heat_map_prev.value_map[y][x] = this->heat_map.value_map[y][x];
-        }
-      }
-    for (int y = 0; y < this->h; y++){ // Then we update it
-      for (int x = 0; x < this->w; x++){
-        this->heat_map.value_map[y][x] -= this->cooling_map.value_map[y][x] / this->flame_height;
-        this->heat_map.value_map[y][x] = max(0, this->heat_map.value_map[y][x]);
-      }
+void PerlinFireProgram::step(float time) {
+  q16_16 *row = this->cooling.row(this->head);  // The top row's, the new bottom one takes it
+  this->head = (this->head + 1) % this->h;
+  SimplexNoise::fill2dOctavesFixed(
+    row,
+    this->w,
+    1,
+    0,
+    toQ48(this->h / this->noise_scale + time * this->speed),  // Q48, as the time runs on for days
+    toQ16(1 / this->noise_scale),
+    0,
+    this->octaves,
+    Q16_ONE / 2
+    );
+  for (int x = 0; x < this->w; x++) {
+    row[x] = mulQ16((row[x] + Q16_ONE) >> 1, this->inverse_flame_height);
+  }
+  this->rows = min(this->rows + 1, this->h);
+}
+
+void PerlinFireProgram::render(Canvas &canvas, float alpha, float time) {
+  if (this->colors == SPECTRAL)
+    this->spectral_palette.rotate(uint16_t(fmod(time * .03 * this->speed, 1.0) * 65536));
+  const Palette &palette = this->colors == SPECTRAL ? this->spectral_palette.rotated() : FIRE_PALETTE;
+  const q16_16 step_alpha = toQ16(alpha - 1);  // The heat of a row, as it was a step before and a row lower, and as it is now
+  q16_16 heat;
+  for (int y = 0; y < this->h; y++) {
+    uint32_t *out = canvas.row(y);
+    const int age = this->h - y;  // Steps of cooling, 1 on the bottom row
+    if (age > this->rows) {  // No heat yet
+      std::fill_n(out, this->w, palette[0]);
+      continue;
     }
-
-    this->cycles = 0;
-  }
-
-  float alpha = this->cycles / periodicity;
-  float heat_val;
-  uint16_t color_hsv;
-  uint8_t h, s, v;
-  for (int y = 0; y < this->h; y++){
-    for (int x = 0; x < this->w; x++){
-      heat_val = (0.5f * this->heat_map_prev.value_map[y][x] + 0.5f * this->heat_map.value_map[y][x]);
-      color_hsv = this->COLOR_PALETTE_HSV[(int)round(36 * heat_val)];
-      h = ((color_hsv >> 16) & 0x0000ff);
-      s = ((color_hsv >> 8) & 0x0000ff);
-      v = (color_hsv & 0x0000ff);
-      h = (uint8_t)((h/255.0 + time * .03 * this->speed) * 255) % 255;
-      matrix.drawPixel(x, y, ColorHSV(uint16_t(h * 255), s, v));
+    const q16_16 *row = this->cooling.row((this->head + y) % this->h);
+    const q16_16 age_alpha = age * Q16_ONE + step_alpha;
+    for (int x = 0; x < this->w; x++) {
+      heat = max(0, Q16_ONE - mulQ16(age_alpha, row[x]));
+      out[x] = palette[Palette::indexFixed(heat)];
     }
   }
-
-  this->cycles += 1;
 }
 
 /*
@@ -198,77 +160,67 @@ Falling sand
 
 ###################################################################################################
 */
-void FallingSandProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  if (this->cycles >= this->period){
-    for (int y = 0; y < matrix_curr.height(); y++) {  // Updating the value map at t-1 so that it contains the values of the value map at t before we update it
-      for (int x = 0; x < matrix_curr.width(); x++) {
-        matrix_prev.value_map[y][x] = matrix_curr.value_map[y][x];
+FallingSandProgram::FallingSandProgram(float speed, float tick_rate, uint width, uint height) :
+      SimulationProgram(speed, tick_rate), sand(width, height), walls(width, height), matrix_curr(width, height), matrix_prev(width, height) {
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) {
+      if (OBSTACLE[y] >> x & 1 && this->matrix_curr.contains(OBSTACLE_X + x, OBSTACLE_Y + y)) {
+        this->walls.set(OBSTACLE_X + x, OBSTACLE_Y + y, true);
+        this->matrix_curr(OBSTACLE_X + x, OBSTACLE_Y + y) = Canvas::Color(255, 255, 255);
       }
     }
+  }
+  this->matrix_prev.copyFrom(this->matrix_curr);
+}
 
-    for (int i = 0; i < this->grain_generation_attemps; i++) {  // Deleting random grains on the bottom row
-      if ((rand() % 10000) / 100.0f < this->grain_generation_proba * 1.05f) {
-        matrix_curr.value_map[matrix_curr.height() - 1][rand() % matrix_curr.width()] = 0;
-      }
-    }
+void FallingSandProgram::removeGrain(int x, int y) {
+  if (this->sand.get(x, y)) {
+    this->sand.set(x, y, false);
+    this->matrix_curr(x, y) = 0;
+  }
+}
 
-    for (int y = matrix_curr.height() - 2; y > -1; y--) {
-      for (int x = matrix_curr.width() - 1; x > -1; x--) {
-        if (this->obstacle.isInHitbox(x, y)) {  // If the considered pixel is in the obstacle's hitbox
-          matrix_curr.value_map[y][x] = matrix.Color(255, 255, 255);
-        }
-        else if (matrix_curr.value_map[y+1][x] == 0) {  // If there's nothing below the considered pixel, move the considered pixel down
-          matrix_curr.value_map[y+1][x] = matrix_curr.value_map[y][x];
-          matrix_curr.value_map[y][x] = 0;
-        }
-        else if (x + 1 < matrix_curr.width() && matrix_curr.value_map[y+1][x+1] == 0 && matrix_curr.value_map[y+1][x-1] == 0) {  // if nothing to the right and the left
-          matrix_curr.value_map[y+1][x + ((rand() % 2) * 2 - 1)] = matrix_curr.value_map[y][x];
-          matrix_curr.value_map[y][x] = 0;
-        }
-        else if (x + 1 < matrix_curr.width() && matrix_curr.value_map[y+1][x+1] == 0 && matrix_curr.value_map[y][x+1] == 0) {  // if nothing to the right
-          matrix_curr.value_map[y+1][x+1] = matrix_curr.value_map[y][x];
-          matrix_curr.value_map[y][x] = 0;
-        }
-        else if (matrix_curr.value_map[y+1][x-1] == 0 && matrix_curr.value_map[y][x-1] == 0) {  // if nothing to the left
-          matrix_curr.value_map[y+1][x-1] = matrix_curr.value_map[y][x];
-          matrix_curr.value_map[y][x] = 0;
-        }
-      }
+void FallingSandProgram::step(float time) {
+  this->matrix_prev.copyFrom(this->matrix_curr);  // Updating the value map at t-1 so that it contains the values of the value map at t before we update it
+  const int w = this->sand.width(), h = this->sand.height();
+
+  for (int i = 0; i < this->grain_generation_attemps; i++) {  // Deleting random grains on the bottom row
+    if ((rand() % 10000) / 100.0f < this->grain_generation_proba * 1.05f) {
+      this->removeGrain(rand() % w, h - 1);
     }
+  }
 
-    for (int x = matrix_curr.width() - 1; x > -1; x--) { // Safety to avoid overflow of grains of sand
-      uint y = this->obstacle.pos_y + 4;
-      if (
-        matrix_curr.value_map[y][x] != 0
-        && matrix_curr.value_map[y+1][x] != 0
-        && matrix_curr.value_map[y+1][x-1] != 0
-        && matrix_curr.value_map[y+1][x+1] != 0
-        ) {
-          //matrix_curr.value_map[y][x] = 0;  // Deleting the grain
-          matrix_curr.value_map[matrix_curr.height() - 1][x] = 0;  // Deleting the bottom row's grain
-      }
+  this->sand.stepSand(this->walls, [this](int x, int y, int to_x, int to_y) {  // The colors follow the grains
+    this->matrix_curr(to_x, to_y) = this->matrix_curr(x, y);
+    this->matrix_curr(x, y) = 0;
+  });
+
+  const int y = OBSTACLE_Y + 4;
+  for (int x = w - 1; x > -1; x--) { // Safety to avoid overflow of grains of sand
+    if (!this->isFree(x, y) && !this->isFree(x, y+1) && !this->isFree(x-1, y+1) && !this->isFree(x+1, y+1)) {
+      this->removeGrain(x, h - 1);  // Deleting the bottom row's grain
     }
+  }
 
-    for (int i = 0; i < this->grain_generation_attemps; i++) {  // Creating new grains
-      if ((rand() % 100) < this->grain_generation_proba) {
-        uint color = ColorHSV(uint16_t(fmod(time * this->speed * 0.01f, 1.0) * 65536), 255, 255);
-        matrix_curr.value_map[0][(matrix_curr.width()/2 - 1) + (rand() % 2)] = color;
+  for (int i = 0; i < this->grain_generation_attemps; i++) {  // Creating new grains
+    if ((rand() % 100) < this->grain_generation_proba) {
+      const int x = (w/2 - 1) + (rand() % 2);
+      if (!this->walls.get(x, 0)) {
+        this->sand.set(x, 0, true);
+        this->matrix_curr(x, 0) = ColorHSV888(uint16_t(fmod(time * this->speed * 0.01f, 1.0) * 65536), 255, 255);
       }
     }
-
-    this->cycles = 0;
   }
+}
 
-  // Now that we're done calculating everything, we apply the values to the actual display matrix
-  for (int y = 0; y < matrix.height(); y++) {
-    for (int x = 0; x < matrix.width(); x++) {
-      //matrix.drawPixel(x, y, matrix_curr.value_map[y][x]);
-      //matrix.drawPixel(x, y, 0.5*matrix_curr.value_map[y][x] + 0.5*matrix_prev.value_map[y][x]);
-      matrix.drawPixel(x, y, interpolateColors565(matrix_prev.value_map[y][x], matrix_curr.value_map[y][x], (float)this->cycles/this->period));
+void FallingSandProgram::render(Canvas &canvas, float alpha, float time) {
+  for (int y = 0; y < canvas.height(); y++) {
+    const uint32_t *prev = this->matrix_prev.row(y), *curr = this->matrix_curr.row(y);
+    uint32_t *out = canvas.row(y);
+    for (int x = 0; x < canvas.width(); x++) {  // Only the cells that changed at the last step are blended
+      out[x] = prev[x] == curr[x] ? curr[x] : interpolateColors888(prev[x], curr[x], alpha);
     }
   }
-
-  this->cycles += 1;
 }
 
 /*
@@ -278,8 +230,8 @@ Lava Lamp
 
 ###################################################################################################
 */
-LavaLampProgram::LavaLampProgram(float speed, uint width, uint height, uint n_balls, float ball_radius) :
-      WS2812MatrixProgram(speed), w(width), h(height), n_balls(n_balls) {
+LavaLampProgram::LavaLampProgram(float speed, float tick_rate, uint width, uint height, uint n_balls, float ball_radius) :
+      SimulationProgram(speed, tick_rate), w(width), h(height), n_balls(n_balls) {
   for (int i = 0; i < n_balls; i++) {
     this->balls.push_back(
       LavaLampProgram::Ball(
@@ -333,8 +285,10 @@ void LavaLampProgram::Ball::update() {
   this->y += this->vy;
 }
 
-void LavaLampProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
+void LavaLampProgram::step(float time) {
   for (int i = 0; i < this->n_balls; i++) {
+    this->balls[i].prev_x = this->balls[i].x;
+    this->balls[i].prev_y = this->balls[i].y;
     this->balls[i].update();
   }
 
@@ -345,25 +299,31 @@ void LavaLampProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
       }
     }
   }
-  
-  for (int y = 0; y < matrix.height(); y++) {
-    for (int x = 0; x < matrix.width(); x++) {
+}
+
+void LavaLampProgram::render(Canvas &canvas, float alpha, float time) {
+  for (int i = 0; i < this->n_balls; i++) {  // Where the balls are between the two last steps
+    this->balls[i].draw_x = this->balls[i].prev_x + alpha * (this->balls[i].x - this->balls[i].prev_x);
+    this->balls[i].draw_y = this->balls[i].prev_y + alpha * (this->balls[i].y - this->balls[i].prev_y);
+  }
+
+  for (int y = 0; y < canvas.height(); y++) {
+    for (int x = 0; x < canvas.width(); x++) {
       float intensity = 0.0f;
       for (int i = 0; i < this->n_balls; i++) {
-        intensity += this->balls[i].r / ((x - this->balls[i].x)*(x - this->balls[i].x) + (y - this->balls[i].y)*(y - this->balls[i].y));
+        intensity += this->balls[i].r / ((x - this->balls[i].draw_x)*(x - this->balls[i].draw_x) + (y - this->balls[i].draw_y)*(y - this->balls[i].draw_y));
       }
       intensity = min(255, intensity) / 255.0;
       float range_min = 0.2f;
       float range_max = 0.9f;
       if (range_min < intensity && intensity < range_max) {
-        uint idx = (intensity - range_min) / (range_max - range_min) * 8 - 1;  // The constant is the length of the color palette
-        matrix.drawPixel(x, y, this->COLOR_PALETTE_565[idx]);
+        canvas.drawPixel(x, y, LAVA_PALETTE[Palette::index((intensity - range_min) / (range_max - range_min))]);
       }
       else if (intensity > range_max) {
-        matrix.drawPixel(x, y, this->COLOR_PALETTE_565[7]);
+        canvas.drawPixel(x, y, LAVA_PALETTE[255]);
       }
       else {
-        matrix.drawPixel(x, y, this->backgroundColor);
+        canvas.drawPixel(x, y, this->backgroundColor);
       }
     }
   }
@@ -377,23 +337,26 @@ void RipplesProgram::spawnRandomRipple(uint min_x, uint max_x, uint min_y, uint
   this->ripples.push_back(RipplesProgram::Ring(radius, x, y, amplitude));
 }
 
-void RipplesProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
+void RipplesProgram::iterate(Canvas &canvas, float time) {
   for (int i = 0; i < this->rippleGenerationAttempts; i++) {  // Creating new ripples
     if ((rand() % 101) < this->rippleGenerationProba) {
-      this->spawnRandomRipple(1, matrix.width() - 1, 1, matrix.height() - 1);
+      this->spawnRandomRipple(1, canvas.width() - 1, 1, canvas.height() - 1);
     }
   }
 
-  for (int y = 0; y < matrix.height(); y++) {
-    for (int x = 0; x < matrix.width(); x++) {
+  const uint16_t hue = uint16_t(fmod(time * this->speed, 1.0) * 65536);
+  this->hsv_row.reserve(canvas.width());
+  for (int y = 0; y < canvas.height(); y++) {
+    for (int x = 0; x < canvas.width(); x++) {
       float intensity = 0.0f;
       for (int i = 0; i < this->ripples.size(); i++) {
         float dist = this->distToRipple(x, y, this->ripples[i]);
         intensity += this->ripples[i].amplitude / (dist * dist);
       }
       intensity = min(1.0f, intensity) * 255;
-      matrix.drawPixel(x, y, ColorHSV(uint16_t(fmod(time * this->speed, 1.0) * 65536), 255, (uint)intensity));
+      this->hsv_row.val[x] = (uint)intensity;
     }
+    ColorHSVValues(hue, 255, this->hsv_row.val.data(), canvas.row(y), canvas.width());
   }
 
   for (int i = 0; i < this->ripples.size(); i++) {
@@ -408,6 +371,49 @@ void RipplesProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
 }
 
 
+/*
+###################################################################################################
+
+Life
+
+###################################################################################################
+*/
+void LifeProgram::seed() {
+  for (int y = 0; y < this->cells.height(); y++) {
+    for (int x = 0; x < this->cells.width(); x++) {
+      this->cells.set(x, y, rand() % 3 == 0);
+    }
+  }
+  this->stale = 0;
+}
+
+void LifeProgram::step(float time) {
+  if (this->stale >= STALE_GENERATIONS) {
+    this->seed();
+  }
+  this->cells.stepLife(this->cells_prev, BIRTH, SURVIVAL, true);
+  this->cells.swap(this->cells_prev);  // The next generation, and the one before it
+
+  const uint32_t hash = this->cells.hash();
+  this->stale = (hash == this->hashes[0] || hash == this->hashes[1]) ? this->stale + 1 : 0;
+  this->hashes[1] = this->hashes[0];
+  this->hashes[0] = hash;
+}
+
+void LifeProgram::render(Canvas &canvas, float alpha, float time) {
+  const uint16_t hue = uint16_t(fmod(time * this->speed, 1.0) * 65536);
+  const uint8_t fade_in = 255 * alpha, fade_out = 255 - fade_in;  // Cells born, and cells dying
+  this->hsv_row.reserve(canvas.width());
+  for (int y = 0; y < canvas.height(); y++) {
+    for (int x = 0; x < canvas.width(); x++) {
+      const bool on = this->cells.get(x, y), was_on = this->cells_prev.get(x, y);
+      this->hsv_row.hue[x] = hue + (x + y) * 1024;
+      this->hsv_row.val[x] = on ? (was_on ? 255 : fade_in) : (was_on ? fade_out : 0);
+    }
+    ColorHSVBatch(this->hsv_row.hue.data(), NULL, this->hsv_row.val.data(), canvas.row(y), canvas.width());
+  }
+}
+
 /*
 ###################################################################################################
 
@@ -415,14 +421,15 @@ Matrix Effect
 
 ###################################################################################################
 */
-void MatrixEffectProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
+void MatrixEffectProgram::iterate(Canvas &canvas, float time) {
   uint8_t r, g, b;
   uint16_t col;
   for (int y = matrix_curr.height() - 1; y > -1; y--) {
       for (int x = 0; x < matrix_curr.width(); x++) {
-        col = matrix_curr.value_map[x][y];
+        col = matrix_curr(x, y);
         if (col) {
-          matrix_curr.value_map[x][y+1] = col;
+          if (y + 1 < matrix_curr.height())  // Drops fall off the bottom
+            matrix_curr(x, y+1) = col;
           r = (col & 0xff0000) >> 16;
           g = (col & 0x00ff00) >> 8;
           b = col & 0xff0000;
@@ -431,20 +438,20 @@ void MatrixEffectProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
           g = round(g * this->dimming_factor);
           b = round(b * this->dimming_factor);
 
-          matrix_curr.value_map[x][y] = (r << 16 | g << 8 | b);  
+          matrix_curr(x, y) = (r << 16 | g << 8 | b);  
         }
       }
   }
 
   for (int i = 0; i < this->drop_generation_attemps; i++) {  // Creating new drops
       if ((rand() % 100) < this->drop_generation_proba) {
-        matrix_curr.value_map[(rand() % matrix_curr.width())][0] = this->color;
+        matrix_curr(rand() % matrix_curr.width(), 0) = this->color;
       }
     }
 
-  for (int y = matrix.height() - 1; y > -1; y--) {  // Writing to the matrix
-      for (int x = 0; x < matrix.width(); x++) {
-        matrix.drawPixel(x, y, color888To565(matrix_curr.value_map[x][y]));
+  for (int y = canvas.height() - 1; y > -1; y--) {  // Writing to the matrix
+      for (int x = 0; x < canvas.width(); x++) {
+        canvas.drawPixel(x, y, matrix_curr(x, y));
       }
   }
 }
@@ -457,8 +464,8 @@ Vortex Effect
 
 ###################################################################################################
 */
-void VortexProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  fadeToBlack(matrix, 0.6f);
+void VortexProgram::iterate(Canvas &canvas, float time) {
+  fadeToBlack(canvas, 0.6f);
 
   float t = time * this->speed;
   uint min_x, max_x, min_y, max_y, x, y;
@@ -467,72 +474,68 @@ void VortexProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
   for (int i = 0; i < max_i; i++) {
     for (int j = 0; j < max_j; j++) {
       min_x = (j*2) + 1;
-      max_x = matrix.width() - 1 - (j*2);
-      x = (sin(t + ((j % 2) ? 128 : 0) + t * (i+j)) * 0.5f + 0.5f) * (max_x - min_x) + min_x;
+      max_x = canvas.width() - 1 - (j*2);
+      x = (fastSin(t + ((j % 2) ? 128 : 0) + t * (i+j)) * 0.5f + 0.5f) * (max_x - min_x) + min_x;
       min_y = (j*2) + 1;
-      max_y = matrix.height() - 1 - (j*2);
-      y = (sin(1.1f * t + ((j % 2) ? 192 : 64) + t * (i+j)) * 0.5f + 0.5f) * (max_y - min_y) + min_y;
-      matrix.drawPixel(x, y, ColorHSV((fmod(t / 10.0f, 1.0f) + (i + j)/(float)(max_i + max_j)) * 65536, 255, 255));
+      max_y = canvas.height() - 1 - (j*2);
+      y = (fastSin(1.1f * t + ((j % 2) ? 192 : 64) + t * (i+j)) * 0.5f + 0.5f) * (max_y - min_y) + min_y;
+      canvas.drawPixel(x, y, ColorHSV888(angle16FromTurns(t / 10.0f + (i + j)/(float)(max_i + max_j)), 255, 255));
     }
   }
-  this->gaussian_blur.blur(matrix);
+  this->gaussian_blur.blur(canvas);
 }
 
 
-void RotatingKaleidoscopeProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  uint8_t dim = matrix.width()/2 + 2;
+void RotatingKaleidoscopeProgram::iterate(Canvas &canvas, float time) {
+  uint8_t dim = canvas.width()/2 + 2;
   float x, y;
   uint16_t hue;
-  uint8_t cx = matrix.width()/2;
-  uint8_t cy = matrix.height()/2;
+  uint8_t cx = canvas.width()/2;
+  uint8_t cy = canvas.height()/2;
   for (float i = 1; i < dim; i += 0.25) {
     float angle = this->speed * time * (dim - i);
-    x = (matrix.width()/2.0f) + sin(angle) * i;
-    y = (matrix.height()/2.0f) + cos(angle) * i;
+    x = (canvas.width()/2.0f) + fastSin(angle) * i;
+    y = (canvas.height()/2.0f) + fastCos(angle) * i;
     hue = (uint16_t)(((x-cx)*(x-cx) + (y-cy)*(y-cy)) * 500 + 100*time * this->speed * 10) % 65535;
-    matrix.drawPixel((uint8_t)x, (uint8_t)y, ColorHSV(hue, 255, 255));
+    canvas.drawPixel((uint8_t)x, (uint8_t)y, ColorHSV888(hue, 255, 255));
   }
-  this->gaussian_blur.blur(matrix);
+  this->gaussian_blur.blur(canvas);
 }
 
 
-OctopusProgram::OctopusProgram(float speed, int height, int width) : WS2812MatrixProgram(speed) {
+OctopusProgram::OctopusProgram(float speed, int height, int width) :
+      WS2812MatrixProgram(speed), r_map_angle(width, height), r_map_radius(width, height) {
   const uint8_t C_X = width / 2;
   const uint8_t C_Y = height / 2;
   const uint8_t MAPP = 255 / max(height, width);
   for (int x = 0; x < width; x++) {
     for (int y = 0; y < height; y++) {
-      this->r_map_angle[x][y] = atan2(y-C_Y, x-C_X);
-      this->r_map_radius[x][y] = pow((x-C_X)*(x-C_X) + (y-C_Y)*(y-C_Y), 0.5f); //thanks Sutaburosu
+      this->r_map_angle(x, y) = atan2(y-C_Y, x-C_X);
+      this->r_map_radius(x, y) = pow((x-C_X)*(x-C_X) + (y-C_Y)*(y-C_Y), 0.5f); //thanks Sutaburosu
     }
   }
 }
 
-void OctopusProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  float angle, radius, arms;
-  for (int x = 0; x < matrix.width(); x++) {
-    for (int y = 0; y < matrix.height(); y++) {
-      angle = this->r_map_angle[x][y];
-      radius = this->r_map_radius[x][y];
-      arms = 0.5 * (sin(0.01f*time*this->speed) + 1) * (this->arms_max - this->arms_min) + this->arms_min;
-      matrix.drawPixel(
-        x,
-        y,
-        ColorHSV(
-          (uint16_t)fmod(3000*radius + 1000*time*this->speed, 65536),
-          255,
-          (uint8_t)(127*(sin((sin((angle * 4 - radius) / 4 + time*this->speed) + 1) + 0.5 * radius - time*this->speed + angle * arms) + 1))
-        )
-      );
+void OctopusProgram::iterate(Canvas &canvas, float time) {
+  float angle, radius;
+  float arms = 0.5 * (fastSin(0.01f*time*this->speed) + 1) * (this->arms_max - this->arms_min) + this->arms_min;
+  this->hsv_row.reserve(canvas.width());
+  for (int y = 0; y < canvas.height(); y++) {
+    const float *angles = this->r_map_angle.row(y), *radii = this->r_map_radius.row(y);
+    for (int x = 0; x < canvas.width(); x++) {
+      angle = angles[x];
+      radius = radii[x];
+      this->hsv_row.hue[x] = angle16FromTurns((3000*radius + 1000*time*this->speed) * (1 / 65536.0f));
+      this->hsv_row.val[x] = (uint8_t)(127*(fastSin((fastSin((angle * 4 - radius) / 4 + time*this->speed) + 1) + 0.5 * radius - time*this->speed + angle * arms) + 1));
     }
+    ColorHSVBatch(this->hsv_row.hue.data(), NULL, this->hsv_row.val.data(), canvas.row(y), canvas.width());
   }
 }
 
 
-void BurstsProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  fadeToBlack(matrix, 0.25f);
+void BurstsProgram::iterate(Canvas &canvas, float time) {
+  fadeToBlack(canvas, 0.25f);
 
-  uint16_t color;
   uint16_t hue;
   float x1, y1, x2, y2;
   float xsteps, ysteps, steps;
@@ -548,53 +551,53 @@ void BurstsProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
   }
 
   for (int i = 0; i < this->num_lines; i++) {
-    x1 = 0.5f * (sin(12 + 1.0*time * this->speed) + 1) * matrix.width();
-    x2 = 0.5f * (sin(10 + 1.1*time * this->speed) + 1) * matrix.width();
-    y1 = 0.5f * (sin(25 + 1.2*time * this->speed + i * 24) + 1) * matrix.height();
-    y2 = 0.5f * (sin(20 + 1.3*time * this->speed + i * 48 + 64) + 1) * matrix.height();
+    x1 = 0.5f * (fastSin(12 + 1.0*time * this->speed) + 1) * canvas.width();
+    x2 = 0.5f * (fastSin(10 + 1.1*time * this->speed) + 1) * canvas.width();
+    y1 = 0.5f * (fastSin(25 + 1.2*time * this->speed + i * 24) + 1) * canvas.height();
+    y2 = 0.5f * (fastSin(20 + 1.3*time * this->speed + i * 48 + 64) + 1) * canvas.height();
 
-    hue = (uint16_t)(fmod(1.0f * i / this->num_lines + 0.1f * time * this->speed, 1.0f) * 65535);
-    drawLine(matrix, x1, x2, y1, y2, hue, 255, 255, true, 0);
-    matrix.drawPixel(y1, y2, ColorHSV(0, 0, 255));  // Drawing a white dot at the tip of each line
+    hue = angle16FromTurns(1.0f * i / this->num_lines + 0.1f * time * this->speed);
+    drawLine(canvas, x1, x2, y1, y2, hue, 255, 255, true, 0);
+    canvas.drawPixel(y1, y2, ColorHSV888(0, 0, 255));  // Drawing a white dot at the tip of each line
   }
-  this->gaussian_blur.blur(matrix);
+  this->gaussian_blur.blur(canvas);
 }
 
 
-void LissajousProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  //matrix.fill(0);
-  uint16_t color;
-  float phase = time * this->speed;
-  float xlocn, ylocn;
+void LissajousProgram::iterate(Canvas &canvas, float time) {
+  //canvas.fill(0);
+  uint32_t color;
+  const angle16 phase = angle16FromRadians(time * this->speed / 2);
+  int32_t xlocn, ylocn;
+  color = ColorHSV888((uint16_t)(100 * time * this->speed), 255, 255);  // Same color for the whole curve
   for (int i = 0; i < 256; i++) {
-    xlocn = sin(phase/2 + 1 * i);
-    ylocn = sin(phase/2 + 2 * i);
+    // The curve steps by whole radians, which add up exactly in angle16 units
+    xlocn = sin16(phase + angle16WholeRadians(1 * i));
+    ylocn = sin16(phase + angle16WholeRadians(2 * i));
 
-    xlocn = (xlocn + 1) * matrix.width() / 2.0f;
-    ylocn = (ylocn + 1) * matrix.height() / 2.0f;
+    xlocn = ((xlocn + 32768) * canvas.width()) >> 16;
+    ylocn = ((ylocn + 32768) * canvas.height()) >> 16;
 
-    color = ColorHSV((uint16_t)(100 * time * this->speed + i * 10), 255, 255);
-    color = ColorHSV((uint16_t)(100 * time * this->speed), 255, 255);
-    matrix.drawPixel((uint8_t)ylocn, (uint8_t)xlocn, color);
+    canvas.drawPixel((uint8_t)ylocn, (uint8_t)xlocn, color);
   }
 }
 
 
-void DnaSpiralProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  matrix.fill(0);
-  uint16_t color, hue;
+void DnaSpiralProgram::iterate(Canvas &canvas, float time) {
+  canvas.fill(0);
+  uint16_t hue;
   uint8_t x1, x2;
   const uint8_t freq = 6;
   float steps, rate, dx;
-  for (int i = 0; i < matrix.height(); i++) {
-    x1 = (matrix.width() / 2) * 0.5f * ((sin(time * this->speed + i * freq) + 1) + sin(0.37f * time * this->speed + i * freq + 128) + 1);
-    x2 = (matrix.width() / 2) * 0.5f * ((sin(time * this->speed + i * freq + 128) + 1) + sin(0.37f * time * this->speed + i * freq + 128 + 64) + 1);
+  for (int i = 0; i < canvas.height(); i++) {
+    x1 = (canvas.width() / 2) * 0.5f * ((fastSin(time * this->speed + i * freq) + 1) + fastSin(0.37f * time * this->speed + i * freq + 128) + 1);
+    x2 = (canvas.width() / 2) * 0.5f * ((fastSin(time * this->speed + i * freq + 128) + 1) + fastSin(0.37f * time * this->speed + i * freq + 128 + 64) + 1);
 
     hue = (uint16_t)(-i * 2048 + 4096 * time * this->speed);
-    drawLine(matrix, x1, i, x2, i, hue, 255, 255, true, abs(x2 - x1) + 1);
+    drawLine(canvas, x1, i, x2, i, hue, 255, 255, true, abs(x2 - x1) + 1);
 
-    matrix.drawPixel(x1, i, 0x8430);
-    matrix.drawPixel(x2, i, 0xffff);
+    canvas.drawPixel(x1, i, color565To888(0x8430));
+    canvas.drawPixel(x2, i, 0xffffff);
   }
 }
 
@@ -606,18 +609,21 @@ TetrahedronProgram
 ###################################################################################################
 */
 void TetrahedronProgram::Point::rotateX(float x, float y, float z, float a) {
+  const float c = fastCos(a), s = fastSin(a);
   this->x = x;
-  this->y = y * cos(a) - z * sin(a);
-  this->z = y * sin(a) + z * cos(a);
+  this->y = y * c - z * s;
+  this->z = y * s + z * c;
 }
 void TetrahedronProgram::Point::rotateY(float x, float y, float z, float a) {
-  this->x = x * cos(a) + z * sin(a);
+  const float c = fastCos(a), s = fastSin(a);
+  this->x = x * c + z * s;
   this->y = y;
-  this->z = x * -sin(a) + z * cos(a);
+  this->z = x * -s + z * c;
 }
 void TetrahedronProgram::Point::rotateZ(float x, float y, float z, float a) {
-  this->x = x * cos(a) - y * sin(a);
-  this->y = x * sin(a) + y * cos(a);
+  const float c = fastCos(a), s = fastSin(a);
+  this->x = x * c - y * s;
+  this->y = x * s + y * c;
   this->z = z;
 }
 
@@ -652,7 +658,7 @@ bool TetrahedronProgram::isInBeetween(TetrahedronProgram::Point const & p, Tetra
   return (abs(dist1 - dist2) < epsilon);
 }
 
-void TetrahedronProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
+void TetrahedronProgram::iterate(Canvas &canvas, float time) {
   float z, projected_x, projected_y;
   float angle_x = 3.14159 * (0.5f * SimplexNoise::noise(time * this->speed * 0.20f) + 0) + 1.00 * time * this->speed;
   float angle_y = 3.14159 * (0.5f * SimplexNoise::noise(time * this->speed * 0.25f) + 0) + 1.05 * time * this->speed;
@@ -667,19 +673,19 @@ void TetrahedronProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
     projected_y = z * this->points[i].y;
 
     // Scaling up the tetrahedron to fit the matrix. Because up to this point, we've worked with a tetrahedron centered on (0, 0, 0) scaled to the unit sphere.
-    projected_x *= matrix.width() * this->tetrahedron_scale; 
-    projected_y *= matrix.height() * this->tetrahedron_scale;
+    projected_x *= canvas.width() * this->tetrahedron_scale; 
+    projected_y *= canvas.height() * this->tetrahedron_scale;
 
     // Moving the tetrahedron's center to the center of the matrix.
-    projected_x += matrix.width() / 2 - 0.5f;
-    projected_y += matrix.height() / 2 - 0.5f;
+    projected_x += canvas.width() / 2 - 0.5f;
+    projected_y += canvas.height() / 2 - 0.5f;
 
     // Now we store the projected coordinates into the Points' coordinates, just so we can reuse those for the drawing functions down below.
     this->points[i].x = (uint8_t)round(projected_x);
     this->points[i].y = (uint8_t)round(projected_y);
   }
 
-  matrix.fill(0);
+  canvas.fill(0);
 
   // We sort points based on their distance so that we can draw lines back to front to avoid a line in the back being drawn on top of line in the front, which looks inconsistent.
   std::sort(
@@ -689,22 +695,22 @@ void TetrahedronProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
     );
 
   // Drawing lines between the points
-  uint16_t hue = uint16_t(fmod(0.025 * time * this->speed, 1.0) * 65536);
-  drawLine(matrix, this->points[3].x, this->points[3].y, this->points[2].x, this->points[2].y, hue + this->getEdgeHue(this->points[3], this->points[2]), 255, 128, false, 0);
-  drawLine(matrix, this->points[3].x, this->points[3].y, this->points[1].x, this->points[1].y, hue + this->getEdgeHue(this->points[3], this->points[1]), 255, 128, false, 0);
-  drawLine(matrix, this->points[3].x, this->points[3].y, this->points[0].x, this->points[0].y, hue + this->getEdgeHue(this->points[3], this->points[0]), 255, 128, false, 0);
-  drawLine(matrix, this->points[2].x, this->points[2].y, this->points[1].x, this->points[1].y, hue + this->getEdgeHue(this->points[2], this->points[1]), 255, 128, false, 0);
-  drawLine(matrix, this->points[2].x, this->points[2].y, this->points[0].x, this->points[0].y, hue + this->getEdgeHue(this->points[2], this->points[0]), 255, 128, false, 0);
-  drawLine(matrix, this->points[1].x, this->points[1].y, this->points[0].x, this->points[0].y, hue + this->getEdgeHue(this->points[1], this->points[0]), 255, 128, false, 0);
+  uint16_t hue = angle16FromTurns(0.025f * time * this->speed);
+  drawLine(canvas, this->points[3].x, this->points[3].y, this->points[2].x, this->points[2].y, hue + this->getEdgeHue(this->points[3], this->points[2]), 255, 128, false, 0);
+  drawLine(canvas, this->points[3].x, this->points[3].y, this->points[1].x, this->points[1].y, hue + this->getEdgeHue(this->points[3], this->points[1]), 255, 128, false, 0);
+  drawLine(canvas, this->points[3].x, this->points[3].y, this->points[0].x, this->points[0].y, hue + this->getEdgeHue(this->points[3], this->points[0]), 255, 128, false, 0);
+  drawLine(canvas, this->points[2].x, this->points[2].y, this->points[1].x, this->points[1].y, hue + this->getEdgeHue(this->points[2], this->points[1]), 255, 128, false, 0);
+  drawLine(canvas, this->points[2].x, this->points[2].y, this->points[0].x, this->points[0].y, hue + this->getEdgeHue(this->points[2], this->points[0]), 255, 128, false, 0);
+  drawLine(canvas, this->points[1].x, this->points[1].y, this->points[0].x, this->points[0].y, hue + this->getEdgeHue(this->points[1], this->points[0]), 255, 128, false, 0);
 
-  this->gaussian_blur.blur(matrix);
+  this->gaussian_blur.blur(canvas);
 
   // Drawing the closest 3 corners
   for (uint8_t i = 0; i < 3; i++)
-    matrix.drawPixel(this->points[i].x, this->points[i].y, 0xffff);
+    canvas.drawPixel(this->points[i].x, this->points[i].y, 0xffffff);
   // Drawing the furthest corner, but only if it is not inside the triangle formed by the closest 3 corners.  This simulates the corner being obstructed by the drawn edges, reinforcing the impression of 3D.
   if (!this->pointIsInTriangle(this->points[3], this->points[0], this->points[1], this->points[2]))
-    matrix.drawPixel(this->points[3].x, this->points[3].y, 0xffff);
+    canvas.drawPixel(this->points[3].x, this->points[3].y, 0xffffff);
 }
 
 /*
@@ -714,32 +720,32 @@ StretchyTetrahedronProgram
 
 ###################################################################################################
 */
-void StretchyTetrahedronProgram::iterate(Adafruit_NeoMatrix &matrix, float time) {
-  matrix.fill(0);
-
-  uint8_t x1 = (uint8_t)(0.5f * (sin(18 + 1.0*time * this->speed) + 1) * matrix.width());
-  uint8_t x2 = (uint8_t)(0.5f * (sin(23 + 1.1*time * this->speed) + 1) * matrix.width());
-  uint8_t x3 = (uint8_t)(0.5f * (sin(27 + 1.2*time * this->speed) + 1) * matrix.width());
-  uint8_t x4 = (uint8_t)(0.5f * (sin(31 + 1.3*time * this->speed) + 1) * matrix.width());
-
-  uint8_t y1 = (uint8_t)(0.5f * (sin(20 + 1.00*time * this->speed) + 1) * matrix.height());
-  uint8_t y2 = (uint8_t)(0.5f * (sin(26 + 1.05*time * this->speed) + 1) * matrix.height());
-  uint8_t y3 = (uint8_t)(0.5f * (sin(15 + 1.10*time * this->speed) + 1) * matrix.height());
-  uint8_t y4 = (uint8_t)(0.5f * (sin(27 + 1.15*time * this->speed) + 1) * matrix.height());
-
-  uint16_t hue = uint16_t(fmod(0.025 * time * this->speed, 1.0) * 65536);
-
-  drawLine(matrix, x1, y1, x2, y2, hue, 255, 255, false, 0);
-  drawLine(matrix, x1, y1, x3, y3, hue, 255, 255, false, 0);
-  drawLine(matrix, x1, y1, x4, y4, hue, 255, 255, false, 0);
-  drawLine(matrix, x2, y2, x3, y3, hue, 255, 255, false, 0);
-  drawLine(matrix, x2, y2, x4, y4, hue, 255, 255, false, 0);
-  drawLine(matrix, x3, y3, x4, y4, hue, 255, 255, false, 0);
-
-  this->gaussian_blur.blur(matrix);
-
-  matrix.drawPixel(x1, y1, 0xffff);
-  matrix.drawPixel(x2, y2, 0xffff);
-  matrix.drawPixel(x3, y3, 0xffff);
-  matrix.drawPixel(x4, y4, 0xffff);
+void StretchyTetrahedronProgram::iterate(Canvas &canvas, float time) {
+  canvas.fill(0);
+
+  uint8_t x1 = (uint8_t)(0.5f * (fastSin(18 + 1.0*time * this->speed) + 1) * canvas.width());
+  uint8_t x2 = (uint8_t)(0.5f * (fastSin(23 + 1.1*time * this->speed) + 1) * canvas.width());
+  uint8_t x3 = (uint8_t)(0.5f * (fastSin(27 + 1.2*time * this->speed) + 1) * canvas.width());
+  uint8_t x4 = (uint8_t)(0.5f * (fastSin(31 + 1.3*time * this->speed) + 1) * canvas.width());
+
+  uint8_t y1 = (uint8_t)(0.5f * (fastSin(20 + 1.00*time * this->speed) + 1) * canvas.height());
+  uint8_t y2 = (uint8_t)(0.5f * (fastSin(26 + 1.05*time * this->speed) + 1) * canvas.height());
+  uint8_t y3 = (uint8_t)(0.5f * (fastSin(15 + 1.10*time * this->speed) + 1) * canvas.height());
+  uint8_t y4 = (uint8_t)(0.5f * (fastSin(27 + 1.15*time * this->speed) + 1) * canvas.height());
+
+  uint16_t hue = angle16FromTurns(0.025f * time * this->speed);
+
+  drawLine(canvas, x1, y1, x2, y2, hue, 255, 255, false, 0);
+  drawLine(canvas, x1, y1, x3, y3, hue, 255, 255, false, 0);
+  drawLine(canvas, x1, y1, x4, y4, hue, 255, 255, false, 0);
+  drawLine(canvas, x2, y2, x3, y3, hue, 255, 255, false, 0);
+  drawLine(canvas, x2, y2, x4, y4, hue, 255, 255, false, 0);
+  drawLine(canvas, x3, y3, x4, y4, hue, 255, 255, false, 0);
+
+  this->gaussian_blur.blur(canvas);
+
+  canvas.drawPixel(x1, y1, 0xffffff);
+  canvas.drawPixel(x2, y2, 0xffffff);
+  canvas.drawPixel(x3, y3, 0xffffff);
+  canvas.drawPixel(x4, y4, 0xffffff);
 }
@@ -1,11 +1,16 @@
 #ifndef WS2812_PROGRAM_H
 #define WS2812_PROGRAM_H
 #include <Arduino.h>
-#include <Adafruit_NeoMatrix.h>
 #include <vector>
 #include <tuple>
 #include <math.h>
+#include "canvas.h"
+#include "cellular_automaton.h"
+#include "grid.h"
 #include "utils.h"
+#include "blur.h"
+#include "palette.h"
+#include "noise_field_cache.h"
 #include "simplex_noise.h"
 
 
@@ -14,224 +19,174 @@ class WS2812MatrixProgram {
     float speed;
 
     WS2812MatrixProgram(float speed){this->speed = speed;};
-    virtual void iterate(Adafruit_NeoMatrix &matrix, float time);
+    virtual ~WS2812MatrixProgram() {}
+    virtual void iterate(Canvas &canvas, float time) = 0;
+};
+
+// A program whose state is simulated at a fixed rate of its own, whatever the frame rate : iterate() runs
+// the steps due by the animation time, none, one or a few, then draws the frame alpha of the way from the
+// state before the last step to the last one. The simulation is a step ahead of the display, which moves
+// on smoothly even when it only steps at 10 Hz.
+class SimulationProgram: public WS2812MatrixProgram {
+  private:
+    const double tick;  // Seconds between steps
+    double next_tick = 0;  // Animation time of the next step
+    bool started = false;
+
+  protected:
+    static constexpr uint8_t MAX_STEPS_PER_FRAME = 4;  // Past them, the simulation falls behind rather than holding the frame up
+
+    virtual void step(float time) = 0;  // Moves the state on by a tick, time being the animation time of the tick
+    virtual void render(Canvas &canvas, float alpha, float time) = 0;  // alpha : 0 is the state before the last step, 1 the last one
+
+  public:
+    SimulationProgram(float speed, float tick_rate) : WS2812MatrixProgram(speed), tick(1.0 / tick_rate) {};
+    void iterate(Canvas &canvas, float time) final;
 };
 
 class StaticProgram: public WS2812MatrixProgram {
   private:
-    uint16_t color;
+    uint32_t color;
   public:
-    StaticProgram(float speed, uint16_t color) : WS2812MatrixProgram(speed), color(color) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time) {matrix.fillScreen(this->color);}
+    StaticProgram(float speed, uint32_t color) : WS2812MatrixProgram(speed), color(color) {};
+    void iterate(Canvas &canvas, float time) {canvas.fill(this->color);}
 };
 
 class SpectralProgram: public WS2812MatrixProgram {
   public:
     SpectralProgram(float speed) : WS2812MatrixProgram(speed) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 class RainbowWaveProgram: public WS2812MatrixProgram {
+  private:
+    HSVRow hsv_row;
+
   public:
     int n_waves = 1;
 
     RainbowWaveProgram(float speed, int n_waves) : WS2812MatrixProgram(speed), n_waves(n_waves) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
+// The plasmas move slowly : at the default speed, a keyframe every 0.05 of noise time is one every
+// 12 frames, each built over 10 frames, so about a tenth of the field is evaluated per frame
+static constexpr float PLASMA_KEYFRAME_INTERVAL = 0.05f;
+static constexpr uint16_t PLASMA_KEYFRAME_BUILD_FRAMES = 10;
+
 class RainbowPlasmaProgram: public WS2812MatrixProgram {
+  private:
+    HSVRow hsv_row;
+    NoiseFieldCache noise_field;
+    std::vector<q16_16> noise_row;
+
   public:
     float scale;
 
-    RainbowPlasmaProgram(float speed, float scale) : WS2812MatrixProgram(speed), scale(scale) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    RainbowPlasmaProgram(float speed, float scale) :
+      WS2812MatrixProgram(speed), noise_field(scale, PLASMA_KEYFRAME_INTERVAL, PLASMA_KEYFRAME_BUILD_FRAMES), scale(scale) {};
+    void iterate(Canvas &canvas, float time);
 };
 
 class FirePlasmaProgram: public WS2812MatrixProgram {  // very similar to RainbowPlasmaProgram, but with a fiery color palette
   private:
-    const uint16_t COLOR_PALETTE_565 [37] = {
-      0x0000, 0x1820, 0x2860, 0x4060, 0x50A0, 0x60E0, 0x70E0,
-      0x8920, 0x9960, 0xA9E0, 0xBA20, 0xC220, 0xDA60, 0xDAA0,
-      0xDAA0, 0xD2E0, 0xD2E0, 0xD321, 0xCB61, 0xCBA1, 0xCBE1,
-      0xCC22, 0xC422, 0xC462, 0xC4A3, 0xBCE3, 0xBCE3, 0xBD24,
-      0xBD24, 0xBD65, 0xB565, 0xB5A5, 0xB5A6, 0xCE6D, 0xDEF3,
-      0xEF78, 0xFFFF,
-    };
-    
+    NoiseFieldCache noise_field;
+    std::vector<q16_16> noise_row;
+
   public:
     float scale;
 
-    FirePlasmaProgram(float speed, float scale) : WS2812MatrixProgram(speed), scale(scale) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    FirePlasmaProgram(float speed, float scale) :
+      WS2812MatrixProgram(speed), noise_field(scale, PLASMA_KEYFRAME_INTERVAL, PLASMA_KEYFRAME_BUILD_FRAMES), scale(scale) {};
+    void iterate(Canvas &canvas, float time);
 };
 
 class SpectralFirePlasmaProgram: public WS2812MatrixProgram {  // very similar to RainbowPlasmaProgram, but with a fiery color palette
   private:
-    const uint32_t COLOR_PALETTE_HSV [37] = {
-      0x000000, 0x07ff18, 0x0cff28, 0x07ff40, 0x0aff50, 0x0cff60, 0x0aff70,
-      0x0bff88, 0x0cff98, 0x0fffa8, 0x0fffb8, 0x0fffc0, 0x0effd8, 0x10ffd8,
-      0x10ffd8, 0x12ffd0, 0x12ffd0, 0x13f5d0, 0x16f4c8, 0x17f4c8, 0x19f4c8,
-      0x1aeac8, 0x1ce9c0, 0x1de9c0, 0x1fdfc0, 0x23ddb8, 0x23ddb8, 0x24d2b8,
-      0x24d2b8, 0x26c7b8, 0x29c5b0, 0x2bc6b4, 0x2bbbb4, 0x2c7dcc, 0x2d4edc,
-      0x2e2fec, 0x5504fc
-    };
-    
+    HueRotatedPalette palette = HueRotatedPalette(SPECTRAL_FIRE_PALETTE);
+    NoiseFieldCache noise_field;
+    std::vector<q16_16> noise_row;
+
   public:
     float scale;
 
-    SpectralFirePlasmaProgram(float speed, float scale) : WS2812MatrixProgram(speed), scale(scale) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    SpectralFirePlasmaProgram(float speed, float scale) :
+      WS2812MatrixProgram(speed), noise_field(scale, PLASMA_KEYFRAME_INTERVAL, PLASMA_KEYFRAME_BUILD_FRAMES), scale(scale) {};
+    void iterate(Canvas &canvas, float time);
 };
 
-class PerlinFireProgram: public WS2812MatrixProgram {
-  private:
-    const uint16_t COLOR_PALETTE_565 [37] = {
-      0x0000, 0x1820, 0x2860, 0x4060, 0x50A0, 0x60E0, 0x70E0,
-      0x8920, 0x9960, 0xA9E0, 0xBA20, 0xC220, 0xDA60, 0xDAA0,
-      0xDAA0, 0xD2E0, 0xD2E0, 0xD321, 0xCB61, 0xCBA1, 0xCBE1,
-      0xCC22, 0xC422, 0xC462, 0xC4A3, 0xBCE3, 0xBCE3, 0xBD24,
-      0xBD24, 0xBD65, 0xB565, 0xB5A5, 0xB5A6, 0xCE6D, 0xDEF3,
-      0xEF78, 0xFFFF,
-    };
-
-  protected:
-    class ValueMap {
-      private:
-          const int w;
-          const int h;
-
-      public:
-          ValueMap(int width, int height) : w(width), h(height) {value_map.resize(h, std::vector<float>(w, 0));}
-          int width() {return w;};
-          int height() {return h;};
-          std::vector<std::vector<float>> value_map;
-      };
+// Heat rises from the bottom row and cools as it goes, at a rate drawn from noise for every row. A row of
+// heat rises along with the row of cooling it was born with, so its heat is 1 - age * cooling : only the
+// cooling is kept, in a ring of rows, and rising is moving the head of the ring.
+class PerlinFireProgram: public SimulationProgram {
+  public:
+    enum Colors : uint8_t {FIRE, SPECTRAL};  // SPECTRAL goes around the color wheel
 
+  private:
     const int w, h;
     float noise_scale;
-    float flame_height;
+    q16_16 inverse_flame_height;
     int octaves;
-    uint cycles = 0;  // number of times iterate has been called
-    ValueMap cooling_map;
-    ValueMap heat_map;  // current heat map
-    ValueMap heat_map_prev;  // previous heat map
-    
-    void createFireSource();
-    void updateCoolingMap(float offset);
-    void applyConvection();
+    const Colors colors;
+    int rows = 0;  // Rows of heat born so far, up to h
+    int head = 0;  // Ring row of the top row, the bottom one is the ring row before it
+    Grid<q16_16> cooling;  // Of a step, for every row
+    HueRotatedPalette spectral_palette = HueRotatedPalette(SPECTRAL_FIRE_PALETTE);
+
+    void step(float time);  // Rises by one row : the top one goes, a new bottom one is born
+    void render(Canvas &canvas, float alpha, float time);
 
   public: 
-    PerlinFireProgram(float speed, float scale, int width, int height, float flame_height, int octaves) : 
-      WS2812MatrixProgram(speed),
-      noise_scale(scale),
+    PerlinFireProgram(float speed, float tick_rate, float scale, int width, int height, float flame_height, int octaves, Colors colors = FIRE) : 
+      SimulationProgram(speed, tick_rate),
       w(width),
       h(height),
-      flame_height(flame_height),
+      noise_scale(scale),
+      inverse_flame_height(toQ16(1 / flame_height)),
       octaves(octaves),
-      heat_map(width, height),
-      cooling_map(width, height),
-      heat_map_prev(width, height)
+      colors(colors),
+      cooling(width, height)
       {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
-};
-
-class SpectralPerlinFireProgram: public PerlinFireProgram {
-  private:
-    /*const uint32_t COLOR_PALETTE_HSV [37] = {
-      0x0bff00, 0x0cff29, 0x0dff3b, 0x0dff48, 0x0eff53, 0x0fff5d, 0x10ff66,
-      0x10ff6e, 0x11ff76, 0x12ff7d, 0x12ff84, 0x13ff8b, 0x13ff91, 0x14ff97,
-      0x14ff9c, 0x15ffa2, 0x15ffa7, 0x15f9ac, 0x15f1b1, 0x15e9b6, 0x15e2bb,
-      0x15dbc0, 0x15d5c4, 0x14cfc9, 0x14c9cd, 0x14c3d1, 0x14bed5, 0x14b8d9,
-      0x14b3dd, 0x14afe1, 0x14aae5, 0x14a5e9, 0x13a1ed, 0x139df0, 0x1399f4,
-      0x1394f8, 0x1391fb,
-    };*/
-    const uint32_t COLOR_PALETTE_HSV [37] = {
-      0x000000, 0x07ff18, 0x0cff28, 0x07ff40, 0x0aff50, 0x0cff60, 0x0aff70,
-      0x0bff88, 0x0cff98, 0x0fffa8, 0x0fffb8, 0x0fffc0, 0x0effd8, 0x10ffd8,
-      0x10ffd8, 0x12ffd0, 0x12ffd0, 0x13f5d0, 0x16f4c8, 0x17f4c8, 0x19f4c8,
-      0x1aeac8, 0x1ce9c0, 0x1de9c0, 0x1fdfc0, 0x23ddb8, 0x23ddb8, 0x24d2b8,
-      0x24d2b8, 0x26c7b8, 0x29c5b0, 0x2bc6b4, 0x2bbbb4, 0x2c7dcc, 0x2d4edc,
-      0x2e2fec, 0x5504fc
-    };
-
-  public: 
-    SpectralPerlinFireProgram(float speed, float scale, int width, int height, float flame_height, int octaves) : 
-      PerlinFireProgram(speed, scale, width, height, flame_height, octaves) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
 };
 
 
-class FallingSandProgram: public WS2812MatrixProgram {
+// The grains are cells of a CellularAutomaton, their colors follow them in matrix_curr
+class FallingSandProgram: public SimulationProgram {
   private:
-    class Obstacle {
-      private:
-        uint8_t sprite[4][4] = {  
-          {0, 1, 1, 0},   /*  initializers for row indexed by 0 */
-          {1, 1, 1, 1},   /*  initializers for row indexed by 1 */
-          {1, 1, 1, 1},   /*  initializers for row indexed by 2 */
-          {0, 1, 1, 0}   /*  initializers for row indexed by 3 */
-        };
-      public:
-        uint pos_x, pos_y;
-        Obstacle(uint pos_x, uint pos_y) : pos_x(pos_x), pos_y(pos_y) {};
-        bool isInHitbox(uint x, uint y) {  // Check if (x, y) is in the obstacle's sprite
-          return (
-            (this->pos_y <= y) && (y <= this->pos_y + 4 - 1) &&  // y is within the height of the sprite
-            (this->pos_x <= x) && (x <= this->pos_x + 4 - 1) &&  // x is within the width of the sprite
-            (this->sprite[y - this->pos_y][x - this->pos_x])  // (x, y) is falling onto a "1" in the sprite
-          );
-        };
-    };
-
-    class ValueMap {
-      private:
-          const uint w;
-          const uint h;
-
-      public:
-          ValueMap(uint width, uint height) : w(width), h(height) {
-              value_map.resize(h, std::vector<uint>(w, 0));
-              for (int y = 0; y < height; y++) {
-                for (int x = 0; x < width; x++) {
-                  value_map[y][x] = 0;
-                }
-              }
-            }
-          uint width() {return w;};
-          uint height() {return h;};
-          std::vector<std::vector<uint>> value_map;
-      };
+    static constexpr uint8_t OBSTACLE[4] = {0b0110, 0b1111, 0b1111, 0b0110};  // Rows of the obstacle's sprite, bit x for column x
+    static constexpr int OBSTACLE_X = 6, OBSTACLE_Y = 4;
 
     const uint grain_generation_attemps = 1;
     const uint grain_generation_proba = 10;  // percentage
-    Obstacle obstacle = Obstacle(6, 4);
-    ValueMap matrix_curr; // We save the visuals of the matrix to do smooth interpolation. Not yet implemented.
-    ValueMap matrix_prev; 
-    uint cycles, period; // The period is the number of frames before each calculation of the next state of the matrix
+    CellularAutomaton sand;
+    CellularAutomaton walls;  // The obstacle
+    Grid<uint32_t> matrix_curr; // Colors of the cells : the grains', white for the obstacle
+    Grid<uint32_t> matrix_prev; // Before the last step, to interpolate between them
+
+    bool isFree(int x, int y) const {return this->matrix_curr.contains(x, y) && !this->sand.get(x, y) && !this->walls.get(x, y);}  // The edges are walls
+    void removeGrain(int x, int y);
+    void step(float time);
+    void render(Canvas &canvas, float alpha, float time);
   public:
-    FallingSandProgram(float speed, uint width, uint height) :
-      WS2812MatrixProgram(speed),
-      matrix_curr(width, height),
-      matrix_prev(width, height),
-      cycles(0),
-      period((uint)(1/speed)) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    FallingSandProgram(float speed, float tick_rate, uint width, uint height);
 };
 
 
-class LavaLampProgram: public WS2812MatrixProgram {  // Based on a MetaBalls approach
+class LavaLampProgram: public SimulationProgram {  // Based on a MetaBalls approach
   private:
     class Ball {
       private:
-        float heat;
+        float heat = 0;
         const float HEAT_ABSORPTION = 5e-6; //0.000005;
         const float GRAVITY = 1e-3;
         const float ATTRACTION = -1e-2;
         const float WALL_REPEL = 5e-6;
       public:
         float r, x, y, vx, vy, max_x, max_y;  // radius, position x and y, velocity x and y, max position x and y
+        float prev_x, prev_y;  // position before the last step
+        float draw_x, draw_y;  // position drawn, between the two
         Ball(float radius, float x, float y, float vx, float vy, float max_x, float max_y) :
-          r(radius), x(x), y(y), vx(vx), vy(vy), max_x(max_x), max_y(max_y) {};
+          r(radius), x(x), y(y), vx(vx), vy(vy), max_x(max_x), max_y(max_y), prev_x(x), prev_y(y) {};
         void update();  // Updates the heat, position, velocity, etc...
         void attractionToOtherBall(Ball otherBall);  // Updates the velocity of the ball based on the position with the other ball
     };
@@ -239,14 +194,12 @@ class LavaLampProgram: public WS2812MatrixProgram {  // Based on a MetaBalls app
     const uint w, h; // matrix width/height
     const uint n_balls;
     std::vector<Ball> balls;
-    const uint16_t backgroundColor = Adafruit_NeoMatrix::Color(0, 0, 168);
-    const uint16_t COLOR_PALETTE_565 [8] = {
-      0xC220, 0xD321, 0xCBA1, 0xCC22,
-      0xC462, 0xBCE3, 0xBD24, 0xBD65
-      };
+    const uint32_t backgroundColor = Canvas::Color(0, 0, 168);
+
+    void step(float time);
+    void render(Canvas &canvas, float alpha, float time);
   public:
-    LavaLampProgram(float speed, uint width, uint height, uint n_balls, float ball_radius);
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    LavaLampProgram(float speed, float tick_rate, uint width, uint height, uint n_balls, float ball_radius);
 };
 
 
@@ -263,35 +216,24 @@ class RipplesProgram: public WS2812MatrixProgram {
   std::vector<Ring> ripples;
   uint rippleGenerationAttempts = 1;
   uint rippleGenerationProba = 5;  // percentage
+  HSVRow hsv_row;
 
   public:
     RipplesProgram(float speed) : WS2812MatrixProgram(speed) {this->spawnRandomRipple(0, 15, 0, 15);};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 class MatrixEffectProgram: public WS2812MatrixProgram {
   private:
-    class ValueMap {
-      private:
-          const int w;
-          const int h;
-
-      public:
-          ValueMap(int width, int height) : w(width), h(height) {value_map.resize(h, std::vector<uint32_t>(w, 0));}
-          int width() {return w;};
-          int height() {return h;};
-          std::vector<std::vector<uint32_t>> value_map;
-      };
-
     const uint16_t color = 0x00ff00;
     const float dimming_factor = 0.67f;
     const uint drop_generation_attemps = 3;
     const uint drop_generation_proba = 10;  // percentage
-    ValueMap matrix_curr;
+    Grid<uint32_t> matrix_curr;
 
   public:
-    MatrixEffectProgram(float speed, uint height, uint width) : WS2812MatrixProgram(speed), matrix_curr(height, width) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    MatrixEffectProgram(float speed, uint width, uint height) : WS2812MatrixProgram(speed), matrix_curr(width, height) {};
+    void iterate(Canvas &canvas, float time);
 };
 
 
@@ -300,7 +242,7 @@ class VortexProgram: public WS2812MatrixProgram {
     GaussianBlur gaussian_blur = GaussianBlur(0.75f);
   public:
     VortexProgram(float speed) : WS2812MatrixProgram(speed) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 
@@ -309,20 +251,21 @@ class RotatingKaleidoscopeProgram: public WS2812MatrixProgram {
     GaussianBlur gaussian_blur = GaussianBlur(0.3f);
   public:
     RotatingKaleidoscopeProgram(float speed) : WS2812MatrixProgram(speed) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 
 class OctopusProgram: public WS2812MatrixProgram {  // Taken from https://editor.soulmatelights.com/gallery/671-octopus
   private:
     GaussianBlur gaussian_blur = GaussianBlur(0.5f);
-    float r_map_angle[16][16];
-    float r_map_radius[16][16];
+    Grid<float> r_map_angle;
+    Grid<float> r_map_radius;
+    HSVRow hsv_row;
     uint8_t arms_min = 1;
     uint8_t arms_max = 5;
   public:
     OctopusProgram(float speed, int height, int width);
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 
@@ -334,7 +277,7 @@ class BurstsProgram: public WS2812MatrixProgram {  // Taken from https://github.
     GaussianBlur gaussian_blur = GaussianBlur(0.45f);
   public:
     BurstsProgram(float speed) : WS2812MatrixProgram(speed) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 
@@ -343,14 +286,35 @@ class LissajousProgram: public WS2812MatrixProgram {
     //GaussianBlur gaussian_blur = GaussianBlur(0.3f);
   public:
     LissajousProgram(float speed) : WS2812MatrixProgram(speed) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 
 class DnaSpiralProgram: public WS2812MatrixProgram {
   public:
     DnaSpiralProgram(float speed) : WS2812MatrixProgram(speed) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
+};
+
+
+class LifeProgram: public SimulationProgram {  // Conway's Game of Life, on a torus
+  private:
+    static constexpr uint16_t BIRTH = 1 << 3;
+    static constexpr uint16_t SURVIVAL = 1 << 2 | 1 << 3;
+    static constexpr uint16_t STALE_GENERATIONS = 40;  // Of a board that stays the same, or blinks, before it's seeded again
+
+    CellularAutomaton cells;
+    CellularAutomaton cells_prev;  // Before the last step, swapped with the next generation at every step
+    uint32_t hashes[2] = {0, 0};  // Of the two generations before the last one
+    uint16_t stale = 0;
+    HSVRow hsv_row;
+
+    void seed();
+    void step(float time);
+    void render(Canvas &canvas, float alpha, float time);
+  public:
+    LifeProgram(float speed, float tick_rate, uint width, uint height) :
+      SimulationProgram(speed, tick_rate), cells(width, height), cells_prev(width, height) {this->seed();};
 };
 
 
@@ -381,7 +345,7 @@ class TetrahedronProgram: public WS2812MatrixProgram {
     bool isInBeetween(TetrahedronProgram::Point const & p, TetrahedronProgram::Point const & v1, TetrahedronProgram::Point const & v2, float epsilon);
   public:
     TetrahedronProgram(float speed) : WS2812MatrixProgram(speed) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 
@@ -391,7 +355,7 @@ class StretchyTetrahedronProgram: public WS2812MatrixProgram {
     GaussianBlur gaussian_blur = GaussianBlur(0.35f);
   public:
     StretchyTetrahedronProgram(float speed) : WS2812MatrixProgram(speed) {};
-    void iterate(Adafruit_NeoMatrix &matrix, float time);
+    void iterate(Canvas &canvas, float time);
 };
 
 #endif